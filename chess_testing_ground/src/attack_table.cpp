@@ -0,0 +1,50 @@
+#include "attack_table.h"
+
+#include <cstring>
+
+#include "position.h"
+
+namespace engine {
+	void attack_table::init(const position& pos) {
+		std::memset(attackers_of, 0, sizeof(attackers_of));
+		std::memset(attacks_from, 0, sizeof(attacks_from));
+		add(pos, pos.pieces());
+	}
+
+	bb attack_table::touching(const position& pos, bb changed) const {
+		const bb sliders = pos.pieces(BISHOP, ROOK, QUEEN);
+		bb b = changed & pos.pieces();
+
+		while (changed)
+			b |= attackers_of[pop_lsb(changed)] & sliders;
+
+		return b;
+	}
+
+	void attack_table::remove(bb sqs) {
+		while (sqs) {
+			square s = pop_lsb(sqs);
+
+			for (bb b = attacks_from[s]; b;)
+				attackers_of[pop_lsb(b)] ^= s;
+
+			attacks_from[s] = 0;
+		}
+	}
+
+	void attack_table::add(const position& pos, bb sqs) {
+		sqs &= pos.pieces();
+
+		while (sqs) {
+			square s = pop_lsb(sqs);
+			piece p = pos.piece_on(s);
+			bb attacks = type_of(p) == PAWN ? pawn_attacks_bb(color_of(p), s) : attacks_bb(type_of(p), s, pos.pieces());
+
+			assert(!attacks_from[s]);
+			attacks_from[s] = attacks;
+
+			while (attacks)
+				attackers_of[pop_lsb(attacks)] |= s;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef ATTACK_TABLE_H_INC
+#define ATTACK_TABLE_H_INC
+
+#include "bitboard.h"
+#include "types.h"
+
+namespace engine {
+	class position;
+
+	//optional incrementally updated attack maps, only kept up to date while attached to a position with set_attack_table()
+	//attackers_of[s] has the squares of every piece attacking s, both colors, & it with pieces(c) for one side
+	//attacks_from[s] is what the piece on s attacks, needed to take its old attacks back out when it moves or its rays change
+	//do_move/undo_move only redo the pieces that move, get captured, and sliders whose rays go through a square that changed
+	class attack_table {
+	public:
+		void init(const position& pos); //full recompute
+
+		bb attackers(square s) const { return attackers_of[s]; }
+		bb attacks(square s) const { return attacks_from[s]; }
+
+		//squares of pieces whose attacks change if the occupancy of the changed squares changes, the pieces on them plus sliders looking at them
+		bb touching(const position& pos, bb changed) const;
+		void remove(bb sqs); //take the attacks of the pieces on these squares out of the table
+		void add(const position& pos, bb sqs); //put the attacks of the pieces on these squares in, with the current occupancy
+
+	private:
+		bb attackers_of[SQUARE_NB];
+		bb attacks_from[SQUARE_NB];
+	};
+}
+
+#endif
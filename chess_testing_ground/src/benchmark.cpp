@@ -0,0 +1,202 @@
+#include "benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "attack_table.h"
+#include "engine.h"
+#include "move_gen.h"
+#include "position.h"
+#include "psqt.h"
+#include "utils.h"
+
+namespace engine {
+	namespace benchmark {
+		const std::vector<std::string> positions = {
+			"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+			"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+			"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+			"4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+			"rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+			"r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+			"r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+			"r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+			"6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+			"3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+			"8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+			"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		};
+
+		namespace {
+			enum query_set { NO_QUERIES, KING_SQUARES, PIECE_SQUARES, ALL_SQUARES, QUERY_SET_NB };
+			constexpr const char* query_names[QUERY_SET_NB] = { "none", "kings", "pieces", "all squares" };
+
+			//stand in for an eval that wants attack info, kings is king safety, pieces is hanging pieces, all squares is a full attack map
+			uint64_t query(const position& pos, query_set qs) {
+				bb sqs = qs == KING_SQUARES ? pos.pieces(KING) : qs == PIECE_SQUARES ? pos.pieces() : qs == ALL_SQUARES ? ~bb(0) : 0;
+				uint64_t sum = 0;
+
+				while (sqs) {
+					square s = pop_lsb(sqs);
+					sum += pop_count(pos.attackers_to(s) & pos.pieces(~pos.side_to_move()));
+				}
+				return sum;
+			}
+
+			uint64_t walk(position& pos, state_info* ss, int depth, query_set qs, uint64_t& nodes) {
+				uint64_t sum = query(pos, qs);
+				nodes++;
+
+				if (depth <= 0)
+					return sum;
+
+				for (const auto& m : move_list<LEGAL>(pos)) {
+					pos.do_move(m, *ss);
+					sum += walk(pos, ss + 1, depth - 1, qs, nodes);
+					pos.undo_move(m);
+				}
+				return sum;
+			}
+
+			//same walk, reading the piece square sums at each node instead
+			int64_t psqt_walk(position& pos, state_info* ss, int depth, bool incremental, uint64_t& nodes) {
+				int mg, eg;
+				if (incremental)
+					mg = pos.psq_mg(), eg = pos.psq_eg();
+				else
+					psqt::compute(pos, mg, eg);
+
+				int64_t sum = mg + eg;
+				nodes++;
+
+				if (depth <= 0)
+					return sum;
+
+				for (const auto& m : move_list<LEGAL>(pos)) {
+					pos.do_move(m, *ss);
+					sum += psqt_walk(pos, ss + 1, depth - 1, incremental, nodes);
+					pos.undo_move(m);
+				}
+				return sum;
+			}
+		}
+
+		void attack_table_bench(int depth) {
+			using clock = std::chrono::steady_clock;
+
+			state_stack ss;
+			position pos;
+			attack_table at;
+			uint64_t nodes = 0, check[2] = {};
+
+			std::cout << "attack table bench, depth " << depth << ", " << positions.size() << " positions\n"
+				<< std::setw(12) << "queries" << std::setw(16) << "recompute ms" << std::setw(12) << "table ms" << std::endl;
+
+			for (int qs = NO_QUERIES; qs < QUERY_SET_NB; qs++) {
+				double ms[2];
+
+				for (int use_table = 0; use_table < 2; use_table++) {
+					nodes = 0;
+					auto start = clock::now();
+
+					for (const auto& fen : positions) {
+						pos.set(fen, &ss[0]);
+						pos.set_attack_table(use_table ? &at : nullptr);
+						check[use_table] = walk(pos, &ss[1], depth, query_set(qs), nodes);
+					}
+
+					ms[use_table] = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+				}
+
+				assert(check[0] == check[1]); //table has to agree with recomputing
+				std::cout << std::setw(12) << query_names[qs] << std::setw(16) << std::fixed << std::setprecision(1) << ms[0] << std::setw(12) << ms[1] << std::endl;
+			}
+
+			std::cout << "nodes per run: " << nodes << std::endl;
+		}
+
+		void psqt_bench(int depth) {
+			using clock = std::chrono::steady_clock;
+
+			state_stack ss;
+			position pos;
+			uint64_t nodes = 0;
+			int64_t check[2] = {};
+			double ms[2];
+
+			//the walk itself (movegen, do/undo) is in both numbers, the difference is what summing the board costs
+			for (int incremental = 0; incremental < 2; incremental++) {
+				nodes = 0;
+				auto start = clock::now();
+
+				for (const auto& fen : positions) {
+					pos.set(fen, &ss[0]);
+					check[incremental] += psqt_walk(pos, &ss[1], depth, incremental, nodes);
+				}
+
+				ms[incremental] = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			}
+
+			assert(check[0] == check[1]); //incremental sums have to agree with recomputing
+			std::cout << "psqt bench, depth " << depth << ", " << positions.size() << " positions, " << nodes << " nodes per run\n"
+				<< std::setw(16) << "recompute ms" << std::setw(16) << "incremental ms" << "\n"
+				<< std::setw(16) << std::fixed << std::setprecision(1) << ms[0] << std::setw(16) << ms[1]
+				<< (check[0] == check[1] ? "" : "  mismatch") << std::endl;
+		}
+
+		void search_bench(_engine& e, int depth) {
+			using clock = std::chrono::steady_clock;
+
+			uint64_t nodes = 0;
+			auto start = clock::now();
+
+			for (const auto& fen : positions) {
+				search::limits_type limits;
+				limits.depth = depth;
+				limits.start_time = search::now();
+
+				e.search_clear();
+				e.set_position(fen, {});
+				e.go(limits);
+				e.wait_for_search_finished();
+				nodes += e.nodes_searched();
+			}
+
+			const double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			sync_cout << "search bench, depth " << depth << ", " << positions.size() << " positions\n"
+				<< "nodes " << nodes << "\n"
+				<< "time ms " << std::fixed << std::setprecision(0) << ms << "\n"
+				<< "nps " << uint64_t(nodes * 1000 / std::max(ms, 1.0)) << sync_endl;
+		}
+
+		void mcts_bench(_engine& e, int playouts) {
+			using clock = std::chrono::steady_clock;
+
+			const bool enabled = mcts::options.enabled;
+			mcts::options.enabled = true;
+
+			uint64_t total = 0;
+			auto start = clock::now();
+
+			for (const auto& fen : positions) {
+				search::limits_type limits;
+				limits.nodes = playouts;
+				limits.start_time = search::now();
+
+				e.set_position(fen, {});
+				e.go(limits);
+				e.wait_for_search_finished();
+				total += e.nodes_searched();
+			}
+
+			const double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			mcts::options.enabled = enabled;
+
+			sync_cout << "mcts bench, " << playouts << " playouts, " << mcts::options.threads << " threads, " << positions.size() << " positions\n"
+				<< "playouts " << total << "\n"
+				<< "time ms " << std::fixed << std::setprecision(0) << ms << "\n"
+				<< "playouts/s " << uint64_t(total * 1000 / std::max(ms, 1.0)) << sync_endl;
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef BENCHMARK_H_INC
+#define BENCHMARK_H_INC
+
+#include <string>
+#include <vector>
+
+namespace engine {
+	class _engine;
+
+	namespace benchmark {
+		//fixed set of positions the bench commands run over, mix of openings, middlegames and endgames
+		extern const std::vector<std::string> positions;
+
+		//times walking the tree to depth while asking for attackers_to() at every node, with and without the incremental attack table
+		void attack_table_bench(int depth);
+
+		//times walking the tree to depth while reading the piece square sums at every node, kept incrementally vs summed over the board
+		void psqt_bench(int depth);
+
+		//searches every position to depth from an empty tt, the total nodes double as a signature and the time is time to depth
+		void search_bench(_engine& e, int depth);
+
+		//runs a fixed number of mcts playouts on every position, reports playouts per second
+		void mcts_bench(_engine& e, int playouts);
+	}
+}
+
+#endif
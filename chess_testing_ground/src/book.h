@@ -0,0 +1,29 @@
+#ifndef BOOK_H_INC
+#define BOOK_H_INC
+
+#include <cstdint>
+#include <string>
+
+#include "position.h"
+#include "types.h"
+
+namespace engine {
+	//polyglot .bin opening books, 16 byte big endian entries (key, move, weight, learn) sorted by key
+	//the file stays memory mapped and gets binary searched in place, nothing is read into memory up front
+	namespace book {
+		//from the uci options
+		struct options_type {
+			int depth = 16;        //only probe while the game is younger than this many plies
+			int randomness = 100;  //0 always plays the heaviest move, 100 picks in proportion to the weights
+		};
+
+		extern options_type options;
+
+		bool open(const std::string& path); //closes the current book first, "<empty>" just closes it
+		void close();
+		uint64_t key(const position& pos);  //polyglot's zobrist key, not the same as our own r_key
+		move probe(const position& pos);    //move::none() when the book has nothing (legal) here
+	}
+}
+
+#endif
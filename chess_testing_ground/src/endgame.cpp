@@ -0,0 +1,285 @@
+#include "endgame.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitboard.h"
+#include "move_gen.h"
+#include "position.h"
+
+namespace engine {
+	namespace {
+		//kpk bitbase, whether the pawn side wins, for every placement with the pawn on files a-d and either side to move
+		//built once at startup by retrograde classification, 24 pawn squares * 64 * 64 king squares * 2 = 196608 bits
+		namespace bitbase {
+			constexpr unsigned MAX_INDEX = 2 * 24 * 64 * 64;
+
+			std::bitset<MAX_INDEX> kpk_bits;
+
+			unsigned index(color stm, square bksq, square wksq, square psq) {
+				return unsigned(wksq) | (bksq << 6) | (stm << 12) | (file_of(psq) << 13) | ((RANK_7 - rank_of(psq)) << 15);
+			}
+
+			enum result { INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4 };
+
+			result& operator|=(result& r, result v) { return r = result(r | v); }
+
+			struct kpk_position {
+				kpk_position() = default;
+				explicit kpk_position(unsigned idx);
+				operator result() const { return res; }
+				result classify(const std::vector<kpk_position>& db);
+
+				color stm;
+				square ksq[COLOR_NB], psq;
+				result res;
+			};
+
+			kpk_position::kpk_position(unsigned idx) {
+				ksq[WHITE] = square(idx & 0x3F);
+				ksq[BLACK] = square((idx >> 6) & 0x3F);
+				stm = color((idx >> 12) & 0x01);
+				psq = make_square(file((idx >> 13) & 0x3), rank(RANK_7 - ((idx >> 15) & 0x7)));
+
+				//kings touching, pieces on top of each other, or black in check with white to move
+				if (distance<square>(ksq[WHITE], ksq[BLACK]) <= 1 || ksq[WHITE] == psq || ksq[BLACK] == psq
+					|| (stm == WHITE && (pawn_attacks_bb(WHITE, psq) & ksq[BLACK])))
+					res = INVALID;
+
+				//the pawn promotes and the new queen can't be taken
+				else if (stm == WHITE && rank_of(psq) == RANK_7 && ksq[WHITE] != psq + NORTH
+					&& (distance<square>(ksq[BLACK], psq + NORTH) > 1 || (attacks_bb<KING>(ksq[WHITE]) & (psq + NORTH))))
+					res = WIN;
+
+				//stalemate, or black takes the pawn
+				else if (stm == BLACK && (!(attacks_bb<KING>(ksq[BLACK]) & ~(attacks_bb<KING>(ksq[WHITE]) | pawn_attacks_bb(WHITE, psq)))
+					|| (attacks_bb<KING>(ksq[BLACK]) & ~attacks_bb<KING>(ksq[WHITE]) & psq)))
+					res = DRAW;
+
+				else
+					res = UNKNOWN;
+			}
+
+			//white to move wins if any move wins, black to move draws if any move draws, otherwise the other one once everything is known
+			result kpk_position::classify(const std::vector<kpk_position>& db) {
+				const result good = stm == WHITE ? WIN : DRAW;
+				const result bad = stm == WHITE ? DRAW : WIN;
+
+				result r = INVALID;
+				bb b = attacks_bb<KING>(ksq[stm]);
+
+				while (b)
+					r |= stm == WHITE ? db[index(BLACK, ksq[BLACK], pop_lsb(b), psq)]
+						: db[index(WHITE, pop_lsb(b), ksq[WHITE], psq)];
+
+				if (stm == WHITE) {
+					if (rank_of(psq) < RANK_7)
+						r |= db[index(BLACK, ksq[BLACK], ksq[WHITE], psq + NORTH)];
+
+					if (rank_of(psq) == RANK_2 && psq + NORTH != ksq[WHITE] && psq + NORTH != ksq[BLACK])
+						r |= db[index(BLACK, ksq[BLACK], ksq[WHITE], psq + NORTH + NORTH)];
+				}
+
+				return res = r & good ? good : r & UNKNOWN ? UNKNOWN : bad;
+			}
+
+			void init() {
+				std::vector<kpk_position> db(MAX_INDEX);
+
+				for (unsigned idx = 0; idx < MAX_INDEX; ++idx)
+					db[idx] = kpk_position(idx);
+
+				//keep going over the unknowns until a pass doesn't resolve any more of them
+				bool repeat;
+				do {
+					repeat = false;
+					for (unsigned idx = 0; idx < MAX_INDEX; ++idx)
+						repeat |= db[idx] == UNKNOWN && db[idx].classify(db) != UNKNOWN;
+				} while (repeat);
+
+				for (unsigned idx = 0; idx < MAX_INDEX; ++idx)
+					if (db[idx] == WIN)
+						kpk_bits.set(idx);
+			}
+
+			bool probe(square wksq, square wpsq, square bksq, color stm) {
+				assert(file_of(wpsq) <= FILE_D);
+				return kpk_bits[index(stm, bksq, wksq, wpsq)];
+			}
+		}
+
+		constexpr bb DARK_SQUARES = 0xAA55AA55AA55AA55ULL;
+
+		int edge_distance(int i) { return std::min(i, 7 - i); }
+
+		//bigger the closer s is to the edge
+		int push_to_edge(square s) {
+			const int rd = edge_distance(rank_of(s)), fd = edge_distance(file_of(s));
+			return 90 - (7 * fd * fd / 2 + 7 * rd * rd / 2);
+		}
+
+		//bigger the closer s is to a1 or h8
+		int push_to_corner(square s) { return std::abs(7 - rank_of(s) - file_of(s)); }
+
+		int push_close(square s1, square s2) { return 140 - 20 * distance<square>(s1, s2); }
+		int push_away(square s1, square s2) { return 120 - push_close(s1, s2); }
+
+		square flip_file(square s) { return square(int(s) ^ int(SQ_H1)); }
+		square flip_rank(square s) { return square(int(s) ^ int(SQ_A8)); }
+
+		bool opposite_colors(square s1, square s2) { return (int(s1) + int(rank_of(s1)) + int(s2) + int(rank_of(s2))) & 1; }
+
+		//for evals that only look at one pawn, mirror so the strong side is white and the pawn is on files a-d
+		square normalize(const position& pos, color strong, square s) {
+			assert(pos.count<PAWN>(strong) == 1);
+
+			if (file_of(pos._square<PAWN>(strong)) >= FILE_E)
+				s = flip_file(s);
+
+			return strong == WHITE ? s : flip_rank(s);
+		}
+
+		//mate with enough material against a lone king, drive the king to the edge and bring ours closer
+		int kxk(const position& pos, color strong) {
+			const color weak = ~strong;
+			const square strong_king = pos._square<KING>(strong);
+			const square weak_king = pos._square<KING>(weak);
+
+			//stalemate would otherwise look like a huge win
+			if (pos.side_to_move() == weak && !has_legal_moves(pos))
+				return VALUE_DRAW;
+
+			int result = pos.non_pawn_material(strong) + pos.count<PAWN>(strong) * pawn_value
+				+ push_to_edge(weak_king) + push_close(strong_king, weak_king);
+
+			if (pos.pieces(strong, QUEEN, ROOK)
+				|| (pos.pieces(strong, BISHOP) && pos.pieces(strong, KNIGHT))
+				|| ((pos.pieces(strong, BISHOP) & DARK_SQUARES) && (pos.pieces(strong, BISHOP) & ~DARK_SQUARES)))
+				result = std::min(result + VALUE_KNOWN_WIN, VALUE_TB_WIN_IN_MAX_PLY - 1);
+
+			return result;
+		}
+
+		//bishop and knight, only the corners of the bishop's color are mates
+		int kbnk(const position& pos, color strong) {
+			const color weak = ~strong;
+			const square strong_king = pos._square<KING>(strong);
+			const square weak_king = pos._square<KING>(weak);
+			const square bishop = pos._square<BISHOP>(strong);
+
+			return VALUE_KNOWN_WIN + 3520 + push_close(strong_king, weak_king)
+				+ 420 * push_to_corner(opposite_colors(bishop, SQ_A1) ? flip_file(weak_king) : weak_king);
+		}
+
+		//exact from the bitbase
+		int kpk(const position& pos, color strong) {
+			const square strong_king = normalize(pos, strong, pos._square<KING>(strong));
+			const square weak_king = normalize(pos, strong, pos._square<KING>(~strong));
+			const square pawn = normalize(pos, strong, pos._square<PAWN>(strong));
+			const color us = strong == pos.side_to_move() ? WHITE : BLACK;
+
+			if (!bitbase::probe(strong_king, pawn, weak_king, us))
+				return VALUE_DRAW;
+
+			return VALUE_KNOWN_WIN + pawn_value + rank_of(pawn);
+		}
+
+		//rook against pawn, a win when our king is in front of the pawn or theirs is too far away, close to a draw otherwise
+		int krkp(const position& pos, color strong) {
+			const color weak = ~strong;
+			const square strong_king = relative_square(strong, pos._square<KING>(strong));
+			const square weak_king = relative_square(strong, pos._square<KING>(weak));
+			const square rook = relative_square(strong, pos._square<ROOK>(strong));
+			const square pawn = relative_square(strong, pos._square<PAWN>(weak));
+			const square queening = make_square(file_of(pawn), RANK_1);
+
+			if (file_of(strong_king) == file_of(pawn) && rank_of(strong_king) < rank_of(pawn))
+				return rook_value - distance<square>(strong_king, pawn);
+
+			if (distance<square>(weak_king, pawn) >= 3 + (pos.side_to_move() == weak) && distance<square>(weak_king, rook) >= 3)
+				return rook_value - distance<square>(strong_king, pawn);
+
+			if (rank_of(weak_king) <= RANK_3 && distance<square>(weak_king, pawn) == 1 && rank_of(strong_king) >= RANK_4
+				&& distance<square>(strong_king, pawn) > 2 + (pos.side_to_move() == strong))
+				return 80 - 8 * distance<square>(strong_king, pawn);
+
+			return 200 - 8 * (distance<square>(strong_king, pawn + SOUTH) - distance<square>(weak_king, pawn + SOUTH)
+				- distance<square>(pawn, queening));
+		}
+
+		//drawish, a little for pushing the king to the edge
+		int krkb(const position& pos, color strong) { return push_to_edge(pos._square<KING>(~strong)); }
+
+		//drawish, more if the knight is far from its king
+		int krkn(const position& pos, color strong) {
+			const square weak_king = pos._square<KING>(~strong);
+			return push_to_edge(weak_king) + push_away(weak_king, pos._square<KNIGHT>(~strong));
+		}
+
+		//a win unless it's a rook or bishop pawn on the 7th with its king next to it
+		int kqkp(const position& pos, color strong) {
+			const color weak = ~strong;
+			const square strong_king = pos._square<KING>(strong);
+			const square weak_king = pos._square<KING>(weak);
+			const square pawn = pos._square<PAWN>(weak);
+
+			int result = push_close(strong_king, weak_king);
+
+			if (relative_rank(weak, pawn) != RANK_7 || distance<square>(weak_king, pawn) != 1
+				|| !((FILEABB | FILECBB | FILEFBB | FILEHBB) & pawn))
+				result += queen_value - pawn_value;
+
+			return result;
+		}
+
+		int kqkr(const position& pos, color strong) {
+			const square strong_king = pos._square<KING>(strong);
+			const square weak_king = pos._square<KING>(~strong);
+
+			return queen_value - rook_value + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+		}
+
+		int knnk(const position&, color) { return VALUE_DRAW; }
+
+		std::unordered_map<uint64_t, endgames::endgame> registry;
+		endgames::endgame kxk_endgames[COLOR_NB] = { { kxk, WHITE }, { kxk, BLACK } };
+
+		//the code names the strong side first, both colors get registered
+		void add(const std::string& code, endgames::eval_fn fn) {
+			for (color c : { WHITE, BLACK }) {
+				state_info st;
+				position pos;
+				registry[pos.set(code, c, &st).r_material_key()] = { fn, c };
+			}
+		}
+	}
+
+	int endgames::endgame::operator()(const position& pos) const {
+		const int v = fn(pos, strong);
+		return pos.side_to_move() == strong ? v : -v;
+	}
+
+	void endgames::init() {
+		bitbase::init();
+
+		add("KPK", kpk);
+		add("KNNK", knnk);
+		add("KBNK", kbnk);
+		add("KRKP", krkp);
+		add("KRKB", krkb);
+		add("KRKN", krkn);
+		add("KQKP", kqkp);
+		add("KQKR", kqkr);
+	}
+
+	const endgames::endgame* endgames::probe(uint64_t material_key) {
+		auto it = registry.find(material_key);
+		return it == registry.end() ? nullptr : &it->second;
+	}
+
+	const endgames::endgame* endgames::kxk(color strong) { return &kxk_endgames[strong]; }
+}
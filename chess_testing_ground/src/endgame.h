@@ -0,0 +1,29 @@
+#ifndef ENDGAME_H_INC
+#define ENDGAME_H_INC
+
+#include <cstdint>
+
+#include "types.h"
+
+namespace engine {
+	class position;
+
+	//hand written evals for material configurations the general eval gets wrong or plays slowly, kpk is exact from a bitbase
+	//registered by material_key at startup, the material table finds them
+	namespace endgames {
+		using eval_fn = int (*)(const position& pos, color strong); //from the strong side's point of view
+
+		struct endgame {
+			eval_fn fn;
+			color strong;
+
+			int operator()(const position& pos) const; //from the side to move's point of view
+		};
+
+		void init();
+		const endgame* probe(uint64_t material_key);
+		const endgame* kxk(color strong); //lone king against enough to mate, not tied to a single key
+	}
+}
+
+#endif
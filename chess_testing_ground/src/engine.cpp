@@ -4,6 +4,8 @@
 #include <sstream>
 
 #include "utils.h"
+#include "nnue.h"
+#include "perft.h"
 #include "position.h"
 #include "trans_table.h"
 #include "uci.h"
@@ -11,22 +13,84 @@
 
 constexpr auto start_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 constexpr int  MaxHashMB = 33554432;
+constexpr auto default_eval_file = "nn.nnue";
 
 namespace engine{
 
     _engine::_engine(std::optional<std::string> path) :
         binary_directory(path ? command_line::get_binary_directory(*path) : ""),
-        states(new std::deque<state_info>(1)) {
+        states(new std::deque<state_info>(1)),
+        worker(tt) {
         pos.set(start_FEN, &states->back());
 
         set_tt_size(16);
+        load_network(default_eval_file);
+
+        search_thread = std::thread(&_engine::idle_loop, this);
+    }
+
+    _engine::~_engine() {
+        stop();
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            exit = true;
+        }
+        cv.notify_all();
+        search_thread.join();
+    }
+
+    //sleeps until go hands it a search, runs it, and goes back to sleep
+    void _engine::idle_loop() {
+        while (true) {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return searching || exit; });
+
+            if (exit)
+                return;
+
+            lk.unlock();
+            worker.start_searching(pos.fen(), states->back(), search_limits);
+            lk.lock();
+
+            searching = false;
+            cv.notify_all(); //wake up anyone in wait_for_search_finished
+        }
+    }
+
+    //anything that touches the position, the tt or the worker's tables has to wait for the search to let go of them
+    void _engine::wait_for_search_finished() {
+        std::unique_lock<std::mutex> lk(mutex);
+        cv.wait(lk, [&] { return !searching; });
+    }
+
+    void _engine::stop() {
+        worker.stop = true;
+    }
+
+    uint64_t _engine::nodes_searched() const {
+        return worker.nodes.load(std::memory_order_relaxed);
+    }
+
+    void _engine::ponderhit() {
+        worker.ponderhit();
+    }
+
+    //as given first, then next to the binary
+    bool _engine::load_network(const std::string& file) {
+        wait_for_search_finished();
+        return nnue::load(file) || (!binary_directory.empty() && nnue::load(binary_directory + file));
     }
 
     void _engine::set_tt_size(size_t mb) {
-        //wait_for_search_finished();
+        wait_for_search_finished();
         tt.resize(mb);
     }
 
+    void _engine::set_multi_pv(size_t lines) {
+        wait_for_search_finished();
+        worker.multi_pv = std::max<size_t>(lines, 1);
+    }
+
     std::string _engine::visualize() const {
         std::stringstream ss;
         ss << pos;
@@ -34,6 +98,8 @@ namespace engine{
     }
 
     void _engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
+        wait_for_search_finished();
+
         // Drop the old state and create a new one
         states = std::unique_ptr<std::deque<state_info>>(new std::deque<state_info>(1));
         pos.set(fen, &states->back());
@@ -49,4 +115,39 @@ namespace engine{
             pos.do_move(m, states->back());
         }
     }
+
+    //run perft on a copy of the current position so the game history isn't touched
+    uint64_t _engine::perft(int depth) {
+        state_stack ss;
+        position p;
+        p.set(pos.fen(), &ss[0]);
+
+        uint64_t nodes = engine::perft<true>(p, &ss[1], std::min(depth, state_stack::STACK_SIZE - 1));
+        std::cout << "\nNodes searched: " << nodes << "\n" << std::endl;
+        return nodes;
+    }
+
+    void _engine::go(search::limits_type& limits) {
+        //a go while still searching queues up behind the current search rather than racing it
+        wait_for_search_finished();
+
+        if (limits.perft) {
+            perft(limits.perft);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lk(mutex);
+        worker.stop = false;
+        worker.ponder = limits.ponder_mode; //set here, a ponderhit can arrive before the search thread wakes up
+        search_limits = limits;
+        searching = true;
+        cv.notify_all();
+    }
+
+    //new game, nothing from the last one should leak into move ordering or tt cutoffs
+    void _engine::search_clear() {
+        wait_for_search_finished();
+        tt.clear();
+        worker.clear();
+    }
  }
\ No newline at end of file
@@ -1,16 +1,20 @@
 #ifndef ENGINE_H_INCLUDED
 #define ENGINE_H_INCLUDED
 
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "position.h"
+#include "search.h"
 #include "trans_table.h"
 
 namespace engine {
@@ -18,13 +22,22 @@ namespace engine {
     class _engine {
     public:
         _engine(std::optional<std::string> path = std::nullopt);
+        ~_engine();
         
         void set_tt_size(size_t mb);
+        void set_multi_pv(size_t lines);
+        bool load_network(const std::string& file);
         void trace_eval() const;
         void stop();
+        void ponderhit();
         void set_position(const std::string& fen, const std::vector<std::string>& moves);
+        uint64_t perft(int depth);
+        void go(search::limits_type& limits);
+        void search_clear();
+        void wait_for_search_finished();
 
         int get_hashfull(int maxAge = 0) const;
+        uint64_t nodes_searched() const;
 
         std::string fen() const;
         void flip();
@@ -37,7 +50,17 @@ namespace engine {
         std::unique_ptr<std::deque<state_info>> states;
 
         transposition_table tt;
+        search::worker      worker;
 
+        //searches run here so the uci thread is always free to read the next command
+        std::thread             search_thread;
+        std::mutex              mutex;
+        std::condition_variable cv;
+        bool                    searching = false;
+        bool                    exit = false;
+        search::limits_type     search_limits;
+
+        void idle_loop();
     };
 
 }  
@@ -0,0 +1,122 @@
+#include "evaluate.h"
+
+#include "bitboard.h"
+#include "material.h"
+#include "nnue.h"
+#include "pawns.h"
+#include "position.h"
+
+namespace engine {
+	bool eval::use_nnue = true;
+
+	namespace {
+		//per square a piece can reach past what it usually reaches, middlegame and endgame
+		constexpr int mobility_mg[PIECE_TYPE_NB] = { 0, 0, 6, 5, 3, 1 };
+		constexpr int mobility_eg[PIECE_TYPE_NB] = { 0, 0, 5, 5, 6, 3 };
+		constexpr int mobility_avg[PIECE_TYPE_NB] = { 0, 0, 4, 6, 7, 13 };
+
+		//how much a piece hitting the squares around the enemy king adds to the danger, queens get counted through the hits
+		constexpr int king_attack_weight[PIECE_TYPE_NB] = { 0, 0, 81, 52, 44, 10 };
+		constexpr int KING_ATTACK_HIT = 69;
+
+		struct king_attack {
+			int attackers, weight, hits;
+		};
+
+		template<color us, piece_type pt>
+		void piece_activity(const position& pos, bb mobility_area, bb king_ring, int& mg, int& eg, king_attack& ka) {
+			for (bb b = pos.pieces(us, pt); b;) {
+				const square s = pop_lsb(b);
+				const bb attacks = attacks_bb<pt>(s, pos.pieces());
+				const int mob = pop_count(attacks & mobility_area) - mobility_avg[pt];
+
+				mg += mobility_mg[pt] * mob;
+				eg += mobility_eg[pt] * mob;
+
+				if (attacks & king_ring) {
+					ka.attackers++;
+					ka.weight += king_attack_weight[pt];
+					ka.hits += pop_count(attacks & king_ring);
+				}
+			}
+		}
+
+		//mobility of us's pieces and the danger they put on the other king, added to white's point of view scores
+		//squares our own pawns and king stand on or their pawns cover don't count as mobility, the pawn entry already has the attacks
+		template<color us>
+		void activity(const position& pos, const pawns::entry& pe, int& mg_white, int& eg_white) {
+			constexpr color them = ~us;
+			const bb mobility_area = ~(pos.pieces(us, PAWN, KING) | pe.pawn_attacks(them));
+			const square ksq = pos._square<KING>(them);
+			const bb king_ring = attacks_bb<KING>(ksq) | ksq;
+
+			int mg = 0, eg = 0;
+			king_attack ka{};
+
+			piece_activity<us, KNIGHT>(pos, mobility_area, king_ring, mg, eg, ka);
+			piece_activity<us, BISHOP>(pos, mobility_area, king_ring, mg, eg, ka);
+			piece_activity<us, ROOK>(pos, mobility_area, king_ring, mg, eg, ka);
+			piece_activity<us, QUEEN>(pos, mobility_area, king_ring, mg, eg, ka);
+
+			//a lone attacker rarely gets anywhere, past that it grows quadratically
+			if (ka.attackers >= 2) {
+				const int danger = ka.attackers * ka.weight + KING_ATTACK_HIT * ka.hits;
+				mg += danger * danger / 4096;
+				eg += danger / 16;
+			}
+
+			mg_white += us == WHITE ? mg : -mg;
+			eg_white += us == WHITE ? eg : -eg;
+		}
+
+		//known endgames first, then the net if one is loaded and wanted, otherwise the hand written eval
+		//the hand written eval is material plus imbalance and pawn structure (both almost always a table hit), the piece square sums
+		//position keeps incrementally, and mobility and king danger which are the only parts that loop over pieces
+		int evaluate_uncached(const position& pos, eval::tables& t) {
+			material::entry* me = material::probe(pos, t.material);
+
+			if (me->specialized_eval_exists())
+				return me->evaluate(pos);
+
+			if (eval::use_nnue && nnue::loaded())
+				return nnue::evaluate(pos);
+
+			const color us = pos.side_to_move();
+			pawns::entry* pe = pawns::probe(pos, t.pawns);
+
+			int mg_white = pos.psq_mg(), eg_white = pos.psq_eg();
+			activity<WHITE>(pos, *pe, mg_white, eg_white);
+			activity<BLACK>(pos, *pe, mg_white, eg_white);
+
+			const int material = pos.non_pawn_material(us) - pos.non_pawn_material(~us)
+				+ (pos.count<PAWN>(us) - pos.count<PAWN>(~us)) * pawn_value + me->imbalance(us);
+
+			int mg = material + pe->mg(us) - pe->mg(~us) + pe->king_shelter(pos, us) - pe->king_shelter(pos, ~us);
+			int eg = material + pe->eg(us) - pe->eg(~us);
+
+			mg += us == WHITE ? mg_white : -mg_white;
+			eg += us == WHITE ? eg_white : -eg_white;
+
+			//the side that's ahead might not be able to win it
+			eg = eg * me->scale_factor(eg > 0 ? us : ~us) / SCALE_FACTOR_NORMAL;
+
+			const int phase = me->game_phase();
+			return (mg * phase + eg * (PHASE_MIDGAME - phase)) / PHASE_MIDGAME;
+		}
+	}
+
+	int eval::evaluate(const position& pos, tables& t) {
+		const uint64_t key = pos.r_key();
+		cache_entry* ce = t.evals[key];
+		t.cache_probes++;
+
+		if (ce->key32 == uint32_t(key >> 32)) {
+			t.cache_hits++;
+			return ce->value;
+		}
+
+		ce->key32 = uint32_t(key >> 32);
+		ce->value = evaluate_uncached(pos, t);
+		return ce->value;
+	}
+}
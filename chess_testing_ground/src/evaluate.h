@@ -0,0 +1,40 @@
+#ifndef EVALUATE_H_INC
+#define EVALUATE_H_INC
+
+#include <cstdint>
+
+#include "material.h"
+#include "pawns.h"
+#include "types.h"
+#include "utils.h"
+
+namespace engine {
+	class position;
+
+	namespace eval {
+		//finished evals by r_key, so the 50 move counter is part of it, the tt has them too but loses them to replacement
+		//8 bytes an entry, 16k of them is 128kb and stays in l2
+		struct cache_entry {
+			uint32_t key32; //high half of the key, the low half picked the slot
+			int32_t value;
+		};
+
+		using cache = hash_table<cache_entry, 16384>;
+
+		//per thread caches the eval reads from, owned by the search worker
+		struct tables {
+			pawns::table pawns;
+			material::table material;
+			cache evals;
+			uint64_t cache_probes = 0, cache_hits = 0;
+		};
+
+		//the net when one is loaded and this is set, otherwise the hand written eval, "Use NNUE" in uci
+		extern bool use_nnue;
+
+		//static evaluation from the side to move's point of view
+		int evaluate(const position& pos, tables& t);
+	}
+}
+
+#endif
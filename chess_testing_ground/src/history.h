@@ -0,0 +1,83 @@
+#ifndef HISTORY_H_INC
+#define HISTORY_H_INC
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "types.h"
+
+namespace engine {
+	constexpr int HISTORY_MAX = 7183; //entries stay inside [-HISTORY_MAX, HISTORY_MAX], fits in an int16
+	constexpr int CORRECTION_HISTORY_SIZE = 16384; //power of two, indexed by the low bits of a structure key
+	constexpr int CORRECTION_HISTORY_MAX = 1024;
+
+	//gravity update, the closer the entry already is to the limit the less the bonus moves it so nothing ever saturates
+	inline void history_update(int16_t& entry, int bonus, int limit = HISTORY_MAX) {
+		int clamped = std::clamp(bonus, -limit, limit);
+		entry += int16_t(clamped - entry * std::abs(clamped) / limit);
+	}
+
+	//quiet move history indexed by side to move and move::from_to(), bumped on cutoffs and used to order quiets in the move picker
+	struct butterfly_history {
+		int16_t table[COLOR_NB][SQUARE_NB * SQUARE_NB];
+
+		int get(color c, move m) const { return table[c][m.from_to()]; }
+		void update(color c, move m, int bonus) { history_update(table[c][m.from_to()], bonus); }
+		void clear() { std::memset(table, 0, sizeof(table)); }
+	};
+
+	//captures indexed by the piece that moved, where it went and what it took, breaks ties between captures of the same victim
+	struct capture_history {
+		int16_t table[int(PIECE_NB) * int(SQUARE_NB) * int(PIECE_TYPE_NB)];
+
+		int get(piece pc, square to, piece_type captured) const { return table[index(pc, to, captured)]; }
+		void update(piece pc, square to, piece_type captured, int bonus) { history_update(table[index(pc, to, captured)], bonus); }
+		void clear() { std::memset(table, 0, sizeof(table)); }
+
+	private:
+		static int index(piece pc, square to, piece_type captured) { return (int(pc) * int(SQUARE_NB) + int(to)) * int(PIECE_TYPE_NB) + int(captured); }
+	};
+
+	//history of (moved piece, to square), one of these per move played a ply or two earlier
+	struct piece_to_history {
+		int16_t table[int(PIECE_NB) * int(SQUARE_NB)];
+
+		int get(piece pc, square to) const { return table[int(pc) * int(SQUARE_NB) + int(to)]; }
+		void update(piece pc, square to, int bonus) { history_update(table[int(pc) * int(SQUARE_NB) + int(to)], bonus); }
+	};
+
+	//how good a move is as a follow up to an earlier one, the search stack keeps a pointer to the row of the move played at each ply
+	//so (ss - 1) is the 1 ply continuation and (ss - 2) the 2 ply one, 2mb so it lives on the heap
+	struct continuation_history {
+		piece_to_history table[int(PIECE_NB) * int(SQUARE_NB)];
+
+		piece_to_history* at(piece pc, square to) { return &table[int(pc) * int(SQUARE_NB) + int(to)]; }
+		piece_to_history* sentinel() { return at(NO_PIECE, SQ_A1); } //for null moves and plies above the root, never updated
+		void clear() { std::memset(table, 0, sizeof(table)); }
+	};
+
+	//the reply that last refuted a move, indexed by the piece that moved and the square it went to
+	struct counter_move_history {
+		move table[PIECE_NB][SQUARE_NB];
+
+		move get(piece p, square s) const { return table[p][s]; }
+		void set(piece p, square s, move m) { table[p][s] = m; }
+		void clear() { std::fill(&table[0][0], &table[0][0] + int(PIECE_NB) * int(SQUARE_NB), move::none()); }
+	};
+
+	//how far the search result ended up from the static eval, averaged over every position sharing a (pawn, minor, ...) key
+	//collisions are fine, its only a nudge to the eval
+	struct correction_history {
+		int16_t table[COLOR_NB][CORRECTION_HISTORY_SIZE];
+
+		int get(color c, uint64_t key) const { return table[c][key & (CORRECTION_HISTORY_SIZE - 1)]; }
+		void update(color c, uint64_t key, int bonus) {
+			history_update(table[c][key & (CORRECTION_HISTORY_SIZE - 1)], bonus, CORRECTION_HISTORY_MAX);
+		}
+		void clear() { std::memset(table, 0, sizeof(table)); }
+	};
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include <iostream>
 
 #include "bitboard.h"
+#include "endgame.h"
+#include "psqt.h"
+#include "search.h"
 #include "utils.h"
 #include "position.h"
 #include "types.h"
@@ -16,6 +19,9 @@ int main(int argc, char* argv[]) {
 	std::cout << "bb initialized" << std::endl;
 	position::init();
 	std::cout << "position initialized" << std::endl;
+	psqt::init();
+	search::init();
+	endgames::init();
 
 	uci_engine uci(argc, argv);
 	std::cout << "uci initialized" << std::endl;
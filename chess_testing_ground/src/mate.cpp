@@ -0,0 +1,238 @@
+#include "mate.h"
+
+#include <algorithm>
+
+#include "move_gen.h"
+
+namespace engine {
+	namespace {
+		constexpr uint32_t INF = 1u << 30;
+
+		uint32_t add(uint32_t a, uint32_t b) { return std::min(INF, a + b); }
+	}
+
+	//legal checks for the attacker, every legal move for the defender, and at the root only the moves go allowed
+	//kept out of mid so the move_list isn't on the stack for every ply of the recursion
+	int mate::solver::generate(const position& pos, int ply, bool attacker) {
+		child_list& cl = children[ply];
+		cl.count = 0;
+
+		for (const move m : move_list<LEGAL>(pos))
+			if ((!attacker || pos.gives_check(m)) && (ply || std::count(root_moves->begin(), root_moves->end(), m)))
+				cl.moves[cl.count++] = m;
+
+		return cl.count;
+	}
+
+	//a proof with fewer plies left also proves it with more, a disproof with more plies left also disproves it with fewer
+	void mate::solver::lookup(uint64_t key, int depth, uint32_t& pn, uint32_t& dn) {
+		const entry* e = (*table)[key];
+		pn = dn = 1;
+
+		if (e->key != key)
+			return;
+
+		if (!e->pn && e->depth <= depth)
+			pn = 0, dn = INF;
+		else if (!e->dn && e->depth >= depth)
+			pn = INF, dn = 0;
+		else if (e->depth == depth)
+			pn = e->pn, dn = e->dn;
+	}
+
+	void mate::solver::store(uint64_t key, int depth, uint32_t pn, uint32_t dn) {
+		*(*table)[key] = { key, pn, dn, depth };
+	}
+
+	bool mate::solver::aborted() {
+		if (!abort && !(nodes & 1023))
+			abort = stop_flag->load(std::memory_order_relaxed)
+				|| (deadline && search::now() >= deadline)
+				|| (max_nodes && nodes >= max_nodes);
+
+		return abort;
+	}
+
+	//phi and delta are pn and dn seen from the side to move, that way or and and nodes are the same code:
+	//phi is the smallest delta of the children and delta the sum of their phis
+	//the node is searched until one of them reaches its threshold, always going into the child that's closest to proving this
+	//node's phi, with thresholds that send the search back up as soon as the second best child would be better
+	void mate::solver::mid(position& pos, int ply, int depth, uint32_t th_phi, uint32_t th_delta) {
+		++nodes;
+
+		const bool attacker = !(ply & 1);
+		const uint64_t key = pos.r_key();
+		const auto set = [&](uint32_t pn, uint32_t dn) { store(key, depth, pn, dn); };
+
+		//out of plies, a draw, or the attacker has no checks left is a disproof
+		if ((attacker && depth <= 0) || (ply && pos.is_draw(ply))) {
+			set(INF, 0);
+			return;
+		}
+
+		child_list& cl = children[ply];
+
+		if (!generate(pos, ply, attacker)) {
+			if (attacker || !pos.checkers())
+				set(INF, 0);
+			else
+				set(0, INF); //mated
+			return;
+		}
+
+		//the defender isn't mated and there's no ply left for another check
+		if (depth <= 0) {
+			set(INF, 0);
+			return;
+		}
+
+		//child keys once, the loop below looks them up every time round
+		state_info& st = states[ply + 1];
+
+		for (int i = 0; i < cl.count; ++i) {
+			pos.do_move(cl.moves[i], st);
+			cl.keys[i] = pos.r_key();
+			pos.undo_move(cl.moves[i]);
+		}
+
+		while (!aborted()) {
+			uint32_t phi = INF, delta = 0, delta2 = INF, best_phi = 0;
+			int best = 0;
+
+			for (int i = 0; i < cl.count; ++i) {
+				uint32_t pn, dn;
+				lookup(cl.keys[i], depth - 1, pn, dn);
+
+				//the child is the other kind of node, its phi is our delta and the other way around
+				const uint32_t child_phi = attacker ? dn : pn;
+				const uint32_t child_delta = attacker ? pn : dn;
+
+				delta = add(delta, child_phi);
+
+				if (child_delta < phi) {
+					delta2 = phi;
+					phi = child_delta;
+					best = i;
+					best_phi = child_phi;
+				}
+				else if (child_delta < delta2)
+					delta2 = child_delta;
+			}
+
+			if (phi >= th_phi || delta >= th_delta) {
+				attacker ? set(phi, delta) : set(delta, phi);
+				return;
+			}
+
+			const uint32_t child_th_phi = uint32_t(std::min<uint64_t>(INF, uint64_t(th_delta) + best_phi - delta));
+			const uint32_t child_th_delta = std::min(th_phi, add(delta2, 1));
+
+			pos.do_move(cl.moves[best], st);
+			mid(pos, ply + 1, depth - 1, child_th_phi, child_th_delta);
+			pos.undo_move(cl.moves[best]);
+		}
+	}
+
+	//whether the attacker mates within depth plies, searching again if the table lost the answer
+	bool mate::solver::prove(position& pos, int ply, int depth) {
+		uint32_t pn, dn;
+		lookup(pos.r_key(), depth, pn, dn);
+
+		if (pn && dn) {
+			mid(pos, ply, depth, INF, INF);
+			lookup(pos.r_key(), depth, pn, dn);
+		}
+
+		return !pn;
+	}
+
+	//plies to the shortest mate from a position with the attacker to move, -1 if there's none within max_depth
+	//a proof in the table only says the mate fits in the plies it was searched with, not how long it really is
+	int mate::solver::mate_distance(position& pos, int ply, int max_depth) {
+		for (int depth = 1; depth <= max_depth; depth += 2)
+			if (prove(pos, ply, depth))
+				return depth;
+
+		return -1;
+	}
+
+	mate::result mate::solver::solve(position& pos, const std::vector<move>& _root_moves, int max_moves, const std::atomic<bool>& stop,
+		search::time_point _deadline, uint64_t _max_nodes) {
+		root_moves = &_root_moves;
+		stop_flag = &stop;
+		deadline = _deadline;
+		max_nodes = _max_nodes;
+		abort = false;
+		nodes = 0;
+
+		if (!table)
+			table = std::make_unique<hash_table<entry, 1 << 20>>();
+		if (!children)
+			children = std::make_unique<child_list[]>(MAX_PLY + 1);
+
+		result r;
+		max_moves = std::min(max_moves, MAX_PLY / 2);
+
+		for (int n = 1; n <= max_moves && !abort; ++n) {
+			const int depth = 2 * n - 1;
+			uint32_t pn, dn;
+
+			mid(pos, 0, depth, INF, INF);
+			lookup(pos.r_key(), depth, pn, dn);
+
+			if (pn)
+				continue;
+
+			//walk down the proven moves, the attacker takes any check that still mates in time and the defender
+			//the reply that holds out longest, so the line is as long as the mate it claims
+			r.moves = n;
+
+			for (int ply = 0; ply < depth; ++ply) {
+				const bool attacker = !(ply & 1);
+				const int left = depth - ply - 1;
+				move next = move::none();
+				int longest = -1;
+
+				generate(pos, ply, attacker);
+				const child_list& cl = children[ply];
+
+				for (int i = 0; i < cl.count; ++i) {
+					pos.do_move(cl.moves[i], states[ply + 1]);
+
+					if (attacker) {
+						if (prove(pos, ply + 1, left))
+							next = cl.moves[i];
+					}
+					else {
+						const int d = mate_distance(pos, ply + 1, left);
+						if (d > longest)
+							longest = d, next = cl.moves[i];
+					}
+
+					pos.undo_move(cl.moves[i]);
+
+					if (attacker && next)
+						break;
+				}
+
+				if (!next)
+					break;
+
+				r.pv.push_back(next);
+				pos.do_move(next, states[ply + 1]);
+			}
+
+			for (auto it = r.pv.rbegin(); it != r.pv.rend(); ++it)
+				pos.undo_move(*it);
+
+			//stopped while the walk had to search again for a proof the table had lost, no move to show for it
+			if (r.pv.empty())
+				r.moves = 0;
+
+			break;
+		}
+
+		r.aborted = abort && !r.moves;
+		return r;
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef MATE_H_INC
+#define MATE_H_INC
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "position.h"
+#include "timeman.h"
+#include "types.h"
+#include "utils.h"
+
+namespace engine {
+	//mate solver for go mate, depth first proof number search (df-pn)
+	//the attacker only gets to play checks and the defender plays everything, a mate is proven once every defence has one
+	//refutation, so the search goes wherever the fewest defences are left to disprove instead of everywhere to a fixed depth
+	namespace mate {
+		struct result {
+			int moves = 0; //mate in this many of our moves, 0 if none was proven
+			bool aborted = false; //ran out of time or nodes before it could prove or rule out the mate
+			std::vector<move> pv;
+		};
+
+		class solver {
+		public:
+			void clear() { if (table) table->clear(); }
+
+			//tries mate in 1, 2 ... max_moves so the first proof is also the shortest mate, only playing root_moves at the root
+			//gives up on stop, after deadline (a now() time, 0 for none) or max_nodes (0 for none)
+			result solve(position& pos, const std::vector<move>& root_moves, int max_moves, const std::atomic<bool>& stop,
+				search::time_point deadline, uint64_t max_nodes);
+
+			uint64_t nodes = 0;
+
+		private:
+			//pn and dn are always from the attacker's side, depth is the plies that were left at that node
+			struct entry {
+				uint64_t key;
+				uint32_t pn, dn;
+				int depth;
+			};
+
+			//the moves tried at one ply and the keys they lead to, one per ply so the recursion doesn't allocate
+			struct child_list {
+				move moves[MAX_MOVES];
+				uint64_t keys[MAX_MOVES];
+				int count;
+			};
+
+			void mid(position& pos, int ply, int depth, uint32_t th_phi, uint32_t th_delta);
+			int generate(const position& pos, int ply, bool attacker);
+			bool prove(position& pos, int ply, int depth);
+			int mate_distance(position& pos, int ply, int max_depth);
+			void lookup(uint64_t key, int depth, uint32_t& pn, uint32_t& dn);
+			void store(uint64_t key, int depth, uint32_t pn, uint32_t dn);
+			bool aborted();
+
+			std::unique_ptr<hash_table<entry, 1 << 20>> table; //24mb, allocated on the first go mate
+			state_stack states;
+			std::unique_ptr<child_list[]> children;
+			const std::vector<move>* root_moves = nullptr; //searchmoves already applied
+			const std::atomic<bool>* stop_flag = nullptr;
+			search::time_point deadline = 0;
+			uint64_t max_nodes = 0;
+			bool abort = false;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include "material.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace engine {
+	namespace {
+		//non pawn material at which the game counts as all middlegame / all endgame
+		constexpr int MIDGAME_LIMIT = 15258;
+		constexpr int ENDGAME_LIMIT = 3915;
+
+		//second degree polynomial imbalance, how much each piece type is worth depending on what else is on the board
+		//index 0 is the bishop pair, then pawn to queen
+		constexpr int quadratic_ours[6][6] = {
+			{ 1438 },
+			{   40,   38 },
+			{   32,  255,  -62 },
+			{    0,  104,    4,    0 },
+			{  -26,   -2,   47,  105, -208 },
+			{ -189,   24,  117,  133, -134, -6 } };
+
+		constexpr int quadratic_theirs[6][6] = {
+			{    0 },
+			{   36,    0 },
+			{    9,   63,    0 },
+			{   59,   65,   42,    0 },
+			{   46,   39,   24,  -24,    0 },
+			{   97,  100,  -42,  137,  268,    0 } };
+
+		template<color us>
+		int imbalance(const int piece_count[][6]) {
+			constexpr color them = ~us;
+			int bonus = 0;
+
+			for (int pt1 = 0; pt1 <= 5; ++pt1) {
+				if (!piece_count[us][pt1])
+					continue;
+
+				int v = 0;
+				for (int pt2 = 0; pt2 <= pt1; ++pt2)
+					v += quadratic_ours[pt1][pt2] * piece_count[us][pt2] + quadratic_theirs[pt1][pt2] * piece_count[them][pt2];
+
+				bonus += piece_count[us][pt1] * v;
+			}
+
+			return bonus;
+		}
+
+		bool is_kxk(const position& pos, color us) {
+			return !more_than_one(pos.pieces(~us)) && pos.non_pawn_material(us) >= rook_value;
+		}
+	}
+
+	material::entry* material::probe(const position& pos, table& t) {
+		const uint64_t key = pos.r_material_key();
+		entry* e = t[key];
+
+		if (e->key == key)
+			return e;
+
+		std::memset(e, 0, sizeof(entry));
+		e->key = key;
+		e->factor[WHITE] = e->factor[BLACK] = uint8_t(SCALE_FACTOR_NORMAL);
+
+		const int npm_w = pos.non_pawn_material(WHITE);
+		const int npm_b = pos.non_pawn_material(BLACK);
+		const int npm = std::clamp(npm_w + npm_b, ENDGAME_LIMIT, MIDGAME_LIMIT);
+
+		e->phase = (npm - ENDGAME_LIMIT) * PHASE_MIDGAME / (MIDGAME_LIMIT - ENDGAME_LIMIT);
+
+		if ((e->specialized = endgames::probe(key)))
+			return e;
+
+		for (color c : { WHITE, BLACK })
+			if (is_kxk(pos, c)) {
+				e->specialized = endgames::kxk(c);
+				return e;
+			}
+
+		//without pawns a small material edge usually can't be converted
+		if (!pos.count<PAWN>(WHITE) && npm_w - npm_b <= bishop_value)
+			e->factor[WHITE] = uint8_t(npm_w < rook_value ? SCALE_FACTOR_DRAW : npm_b <= bishop_value ? 4 : 14);
+
+		if (!pos.count<PAWN>(BLACK) && npm_b - npm_w <= bishop_value)
+			e->factor[BLACK] = uint8_t(npm_b < rook_value ? SCALE_FACTOR_DRAW : npm_w <= bishop_value ? 4 : 14);
+
+		const int piece_count[COLOR_NB][6] = {
+			{ pos.count<BISHOP>(WHITE) > 1, pos.count<PAWN>(WHITE), pos.count<KNIGHT>(WHITE),
+			  pos.count<BISHOP>(WHITE), pos.count<ROOK>(WHITE), pos.count<QUEEN>(WHITE) },
+			{ pos.count<BISHOP>(BLACK) > 1, pos.count<PAWN>(BLACK), pos.count<KNIGHT>(BLACK),
+			  pos.count<BISHOP>(BLACK), pos.count<ROOK>(BLACK), pos.count<QUEEN>(BLACK) } };
+
+		e->imbalance_white = (imbalance<WHITE>(piece_count) - imbalance<BLACK>(piece_count)) / 16;
+
+		return e;
+	}
+}
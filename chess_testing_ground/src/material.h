@@ -0,0 +1,39 @@
+#ifndef MATERIAL_H_INC
+#define MATERIAL_H_INC
+
+#include <cstdint>
+
+#include "endgame.h"
+#include "position.h"
+#include "types.h"
+#include "utils.h"
+
+namespace engine {
+	constexpr int SCALE_FACTOR_DRAW = 0;
+	constexpr int SCALE_FACTOR_NORMAL = 64;
+	constexpr int PHASE_MIDGAME = 128;
+
+	//everything that only depends on which pieces are on the board, cached per material_key
+	//the key only changes on captures and promotions so this is a hit nearly every time
+	namespace material {
+		struct entry {
+			bool specialized_eval_exists() const { return specialized != nullptr; }
+			int evaluate(const position& pos) const { return (*specialized)(pos); }
+			int imbalance(color c) const { return c == WHITE ? imbalance_white : -imbalance_white; }
+			int scale_factor(color c) const { return factor[c]; } //out of SCALE_FACTOR_NORMAL, applied to the endgame part
+			int game_phase() const { return phase; } //PHASE_MIDGAME down to 0
+
+			uint64_t key;
+			const endgames::endgame* specialized;
+			int imbalance_white;
+			int phase;
+			uint8_t factor[COLOR_NB];
+		};
+
+		using table = hash_table<entry, 8192>;
+
+		entry* probe(const position& pos, table& t);
+	}
+}
+
+#endif
@@ -0,0 +1,322 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "move_gen.h"
+#include "timeman.h"
+
+namespace engine {
+	mcts::options_type mcts::options;
+
+	namespace {
+		using namespace mcts;
+
+		constexpr uint32_t ARENA_NODES = 1 << 21; //64mb, when it's full leaves get evaluated but not expanded any more
+		constexpr double SCALE = 1 << 16;         //fixed point for value_sum
+		constexpr float CPUCT = 1.8f;             //exploration, how much a prior is worth against a good q
+		constexpr float FPU_REDUCTION = 0.3f;     //an unvisited child counts as this much worse than its parent
+		constexpr double VALUE_SCALE = 3.0 * pawn_value;   //eval to q, q = tanh(eval / VALUE_SCALE)
+		constexpr double PRIOR_TEMPERATURE = pawn_value;    //softmax temperature for turning the children's evals into priors
+
+		enum node_state : uint8_t { UNEXPANDED, EXPANDING, EXPANDED, DRAW, MATED };
+
+		float to_q(int v) { return float(std::tanh(v / VALUE_SCALE)); }
+	}
+
+	//everything a thread needs to walk the tree on its own board
+	struct mcts::searcher::thread_data {
+		position pos;
+		state_stack states;
+		nnue::accumulator_stack accumulators;
+		eval::tables tables;
+		std::vector<node*> path;
+	};
+
+	mcts::searcher::searcher() = default;
+	mcts::searcher::~searcher() = default;
+
+	void mcts::searcher::clear() {
+		for (auto& td : threads)
+			td->tables.evals.clear();
+	}
+
+	mcts::node* mcts::searcher::allocate(size_t count) {
+		//checked first so a full arena doesn't keep counting up until it wraps
+		if (used.load(std::memory_order_relaxed) + count > ARENA_NODES)
+			return nullptr;
+
+		const uint32_t first = used.fetch_add(uint32_t(count), std::memory_order_relaxed);
+		return first + count <= ARENA_NODES ? &arena[first] : nullptr;
+	}
+
+	//puct, q plus a bonus for priors that haven't had their share of visits yet
+	//virtual losses count as lost visits until the thread that left them backs up
+	mcts::node* mcts::searcher::select(node* n) const {
+		const uint32_t first = n->first_child.load(std::memory_order_relaxed);
+		const uint16_t count = n->child_count.load(std::memory_order_relaxed);
+
+		const uint32_t parent_visits = n->visits.load(std::memory_order_relaxed);
+		const int32_t parent_vl = n->virtual_loss.load(std::memory_order_relaxed);
+
+		//the node's own value is stored for the side that moved into it, its children are played by the other side
+		const float parent_q = parent_visits ? float(-n->value_sum.load(std::memory_order_relaxed) / SCALE / parent_visits) : 0.0f;
+		const float fpu = parent_q - FPU_REDUCTION;
+		const float sqrt_n = std::sqrt(float(std::max<int64_t>(1, int64_t(parent_visits) + parent_vl)));
+
+		node* best = nullptr;
+		float best_score = -1e9f;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			node* c = &arena[first + i];
+
+			const uint32_t v = c->visits.load(std::memory_order_relaxed);
+			const int32_t vl = c->virtual_loss.load(std::memory_order_relaxed);
+			const int64_t n_eff = int64_t(v) + vl;
+
+			const float q = n_eff > 0 ? float((c->value_sum.load(std::memory_order_relaxed) / SCALE - vl) / n_eff) : fpu;
+			const float score = q + CPUCT * c->prior * sqrt_n / float(1 + n_eff);
+
+			if (score > best_score) {
+				best_score = score;
+				best = c;
+			}
+		}
+
+		return best;
+	}
+
+	//generates the node's moves and evaluates every child back to back, that's the batch: they all come off the same
+	//parent accumulator, so each eval is one incremental update and the forward pass with the weights still in cache
+	//the children's evals become the priors, and the best of them the node's value for the side to move
+	float mcts::searcher::expand(thread_data& td, node* n, int ply, const std::vector<move>* only) {
+		position& pos = td.pos;
+
+		if (ply && pos.is_draw(ply)) {
+			n->state.store(DRAW, std::memory_order_release);
+			return 0.0f;
+		}
+
+		move moves[MAX_MOVES];
+		size_t count = 0;
+
+		for (const move m : move_list<LEGAL>(pos))
+			if (!only || std::count(only->begin(), only->end(), m))
+				moves[count++] = m;
+
+		if (!count) {
+			n->state.store(pos.checkers() ? MATED : DRAW, std::memory_order_release);
+			return pos.checkers() ? -1.0f : 0.0f;
+		}
+
+		int values[MAX_MOVES];
+		int best = -VALUE_INFINITE;
+		state_info& st = td.states[ply + 1];
+
+		for (size_t i = 0; i < count; ++i) {
+			pos.do_move(moves[i], st);
+			values[i] = -eval::evaluate(pos, td.tables);
+			pos.undo_move(moves[i]);
+			best = std::max(best, values[i]);
+		}
+
+		eval_count.fetch_add(count, std::memory_order_relaxed);
+
+		node* children = allocate(count);
+
+		//out of arena, this stays a leaf that just gets evaluated every time
+		if (!children) {
+			n->state.store(UNEXPANDED, std::memory_order_release);
+			return to_q(best);
+		}
+
+		double sum = 0;
+		float priors[MAX_MOVES];
+		for (size_t i = 0; i < count; ++i)
+			sum += priors[i] = float(std::exp((values[i] - best) / PRIOR_TEMPERATURE));
+
+		for (size_t i = 0; i < count; ++i) {
+			node& c = children[i];
+			c.m = moves[i];
+			c.prior = float(priors[i] / sum);
+			c.visits.store(0, std::memory_order_relaxed);
+			c.virtual_loss.store(0, std::memory_order_relaxed);
+			c.value_sum.store(0, std::memory_order_relaxed);
+			c.first_child.store(0, std::memory_order_relaxed);
+			c.child_count.store(0, std::memory_order_relaxed);
+			c.state.store(UNEXPANDED, std::memory_order_relaxed);
+		}
+
+		n->first_child.store(uint32_t(children - arena.get()), std::memory_order_relaxed);
+		n->child_count.store(uint16_t(count), std::memory_order_relaxed);
+		n->state.store(EXPANDED, std::memory_order_release); //children are only read after seeing this
+
+		return to_q(best);
+	}
+
+	void mcts::searcher::playouts(thread_data& td, const std::atomic<bool>& stop, uint64_t max_playouts, bool main,
+		const std::function<bool()>& time_up, const std::function<void(const result&)>& report) {
+		position& pos = td.pos;
+		search::time_point last_report = search::now();
+
+		while (!done.load(std::memory_order_relaxed)) {
+			node* n = &arena[0];
+			int ply = 0;
+
+			td.path.clear();
+			td.path.push_back(n);
+			n->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+
+			while (n->state.load(std::memory_order_acquire) == EXPANDED && ply < MAX_PLY - 1) {
+				n = select(n);
+				n->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+				pos.do_move(n->m, td.states[++ply]);
+				td.path.push_back(n);
+			}
+
+			float v; //for the side to move at the leaf
+			uint8_t state = n->state.load(std::memory_order_acquire);
+
+			if (state == DRAW)
+				v = 0.0f;
+			else if (state == MATED)
+				v = -1.0f;
+			else if (ply >= MAX_PLY - 1)
+				v = to_q(eval::evaluate(pos, td.tables));
+			else if (state == UNEXPANDED && n->state.compare_exchange_strong(state, EXPANDING))
+				v = expand(td, n, ply, nullptr);
+			else {
+				//another thread is expanding this leaf, take the virtual losses back and go again
+				collision_count.fetch_add(1, std::memory_order_relaxed);
+
+				for (size_t i = td.path.size() - 1; i > 0; --i) {
+					td.path[i]->virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+					pos.undo_move(td.path[i]->m);
+				}
+				td.path[0]->virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+
+				std::this_thread::yield();
+				continue;
+			}
+
+			//each node keeps its value for the side that moved into it, so the sign flips every ply on the way up
+			double x = -v;
+			for (size_t i = td.path.size(); i-- > 0;) {
+				node* p = td.path[i];
+				p->value_sum.fetch_add(int64_t(x * SCALE), std::memory_order_relaxed);
+				p->visits.fetch_add(1, std::memory_order_relaxed);
+				p->virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+
+				if (i)
+					pos.undo_move(p->m);
+				x = -x;
+			}
+
+			int depth = max_depth.load(std::memory_order_relaxed);
+			while (ply > depth && !max_depth.compare_exchange_weak(depth, ply))
+				;
+
+			const uint64_t count = playout_count.fetch_add(1, std::memory_order_relaxed) + 1;
+
+			if (max_playouts && count >= max_playouts)
+				done = true;
+
+			//the clock and the output are the main thread's job
+			if (main && !(count & 255)) {
+				if (stop.load(std::memory_order_relaxed) || time_up())
+					done = true;
+				else if (search::now() - last_report >= 1000) {
+					last_report = search::now();
+					report(current());
+				}
+			}
+
+			if (stop.load(std::memory_order_relaxed))
+				done = true;
+		}
+	}
+
+	void mcts::searcher::run(const std::string& fen, const state_info& root_state, const std::vector<move>& root_moves,
+		const std::atomic<bool>& stop, uint64_t max_playouts,
+		const std::function<bool()>& time_up, const std::function<void(const result&)>& report) {
+		if (!arena)
+			arena = std::make_unique<node[]>(ARENA_NODES);
+
+		while (threads.size() < size_t(std::max(1, options.threads)))
+			threads.push_back(std::make_unique<thread_data>());
+
+		//same as the alpha-beta root, the copied state keeps the game history for repetitions
+		for (int i = 0; i < std::max(1, options.threads); ++i) {
+			thread_data& td = *threads[i];
+			td.pos.set(fen, &td.states[0]);
+			td.states[0] = root_state;
+			td.pos.set_accumulator_stack(&td.accumulators);
+			td.path.reserve(MAX_PLY);
+		}
+
+		//a fresh tree every search, the root gets expanded up front so searchmoves can be applied to it
+		node& root = arena[0];
+		root.m = move::none();
+		root.prior = 1.0f;
+		root.visits = 0;
+		root.virtual_loss = 0;
+		root.value_sum = 0;
+		root.state = EXPANDING;
+
+		used = 1;
+		playout_count = eval_count = collision_count = 0;
+		max_depth = 0;
+		done = false;
+
+		const float root_value = expand(*threads[0], &root, 0, &root_moves);
+		root.visits = 1;
+		root.value_sum = int64_t(-root_value * SCALE);
+
+		std::vector<std::thread> helpers;
+		for (int i = 1; i < options.threads; ++i)
+			helpers.emplace_back([&, i] { playouts(*threads[i], stop, max_playouts, false, time_up, report); });
+
+		playouts(*threads[0], stop, max_playouts, true, time_up, report);
+
+		for (auto& t : helpers)
+			t.join();
+	}
+
+	mcts::result mcts::searcher::current() const {
+		result r;
+		const node* n = &arena[0];
+
+		const uint32_t root_visits = n->visits.load(std::memory_order_relaxed);
+		r.q = root_visits ? float(-n->value_sum.load(std::memory_order_relaxed) / SCALE / root_visits) : 0.0f;
+		r.playouts = playout_count.load(std::memory_order_relaxed);
+		r.evals = eval_count.load(std::memory_order_relaxed);
+		r.collisions = collision_count.load(std::memory_order_relaxed);
+		r.sel_depth = max_depth.load(std::memory_order_relaxed);
+		r.score = int(std::atanh(std::clamp(r.q, -0.999f, 0.999f)) * VALUE_SCALE);
+
+		//most visited child all the way down
+		while (n->state.load(std::memory_order_acquire) == EXPANDED) {
+			const node* best = nullptr;
+			const uint32_t first = n->first_child.load(std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i < n->child_count.load(std::memory_order_relaxed); ++i) {
+				const node* c = &arena[first + i];
+				if (!best || c->visits.load(std::memory_order_relaxed) > best->visits.load(std::memory_order_relaxed))
+					best = c;
+			}
+
+			if (!best->visits.load(std::memory_order_relaxed) && !r.pv.empty())
+				break;
+
+			//a child with no moves that's in check is a mate we know for sure, q can't say that
+			if (r.pv.empty() && best->state.load(std::memory_order_acquire) == MATED)
+				r.score = mate_in(1);
+
+			r.pv.push_back(best->m);
+			n = best;
+		}
+
+		return r;
+	}
+}
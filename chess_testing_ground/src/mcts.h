@@ -0,0 +1,84 @@
+#ifndef MCTS_H_INC
+#define MCTS_H_INC
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "evaluate.h"
+#include "nnue.h"
+#include "position.h"
+#include "types.h"
+
+namespace engine {
+	//monte carlo tree search with puct selection, the alternative to alpha-beta for analysis, "SearchMode mcts" in uci
+	//every playout walks down the tree to a leaf, expands it and backs the leaf's value up the path
+	//threads share one tree and leave a virtual loss on each node they walk through, so the next thread down
+	//sees that path as worse for a moment and spreads out instead of queueing up on the same leaf
+	namespace mcts {
+		struct options_type {
+			bool enabled = false;
+			int threads = 1;
+		};
+
+		extern options_type options;
+
+		//q is kept as fixed point so the sum can be a plain atomic add, from the side that played m into this node
+		struct node {
+			move m;
+			float prior;
+			std::atomic<uint32_t> visits;
+			std::atomic<int32_t> virtual_loss;
+			std::atomic<int64_t> value_sum;
+			std::atomic<uint32_t> first_child;
+			std::atomic<uint16_t> child_count;
+			std::atomic<uint8_t> state;
+		};
+
+		struct result {
+			std::vector<move> pv; //most visited line
+			float q = 0;          //root q for the side to move, -1..1
+			uint64_t playouts = 0;
+			uint64_t evals = 0;
+			uint64_t collisions = 0; //playouts that ran into a leaf another thread was expanding
+			int sel_depth = 0;
+			int score = 0;        //q back on the eval's scale, for info lines
+		};
+
+		class searcher {
+		public:
+			searcher();
+			~searcher();
+
+			//root_moves are the moves the root may play (searchmoves already applied)
+			//time_up is polled by the calling thread, report gets called about once a second for info lines
+			void run(const std::string& fen, const state_info& root_state, const std::vector<move>& root_moves,
+				const std::atomic<bool>& stop, uint64_t max_playouts,
+				const std::function<bool()>& time_up, const std::function<void(const result&)>& report);
+
+			result current() const;
+			void clear(); //drops every thread's eval cache, for when the eval changes underneath them
+
+		private:
+			struct thread_data;
+
+			void playouts(thread_data& td, const std::atomic<bool>& stop, uint64_t max_playouts, bool main,
+				const std::function<bool()>& time_up, const std::function<void(const result&)>& report);
+			float expand(thread_data& td, node* n, int ply, const std::vector<move>* only);
+			node* select(node* n) const;
+			node* allocate(size_t count);
+
+			std::unique_ptr<node[]> arena; //allocated on the first mcts search, it's big
+			std::atomic<uint32_t> used{ 0 };
+			std::atomic<bool> done{ false };
+			std::atomic<uint64_t> playout_count{ 0 }, eval_count{ 0 }, collision_count{ 0 };
+			std::atomic<int> max_depth{ 0 };
+			std::vector<std::unique_ptr<thread_data>> threads;
+		};
+	}
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "memory.h"
 
 #include <cstdlib>
+#include <malloc.h>
 #include <ios>
 #include <iostream>
 #include <ostream>
@@ -21,6 +22,14 @@ extern "C" {
 }
 
 namespace engine {
+    void* std_aligned_alloc(size_t alignment, size_t size) {
+        return _aligned_malloc(size, alignment);
+    }
+
+    void std_aligned_free(void* ptr) {
+        _aligned_free(ptr);
+    }
+
     void aligned_large_pages_free(void* mem) {
 
         if (mem && !VirtualFree(mem, 0, MEM_RELEASE))
@@ -14,5 +14,9 @@
 namespace engine {
 	void* aligned_large_pages_alloc(size_t size);
 	void  aligned_large_pages_free(void* mem);
+
+	//plain aligned allocation for small things that want cache line alignment, like the state stack
+	void* std_aligned_alloc(size_t alignment, size_t size);
+	void  std_aligned_free(void* ptr);
 }
 #endif
\ No newline at end of file
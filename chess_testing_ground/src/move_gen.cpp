@@ -7,153 +7,128 @@
 
 namespace engine {
 	namespace {
-		template<gen_type t, direction d, bool enemy>
-		ext_move* make_promotions(ext_move* move_list, [[maybe_unused]] square to) { //saw this in stockfish, maybe_unused supressed compiler warnings saying that a variable isn't used in function body
-			constexpr bool all = t == EVASIONS || t == NON_EVASIONS;
-
-			if constexpr (t ==CAPS || all)
-				*move_list++ = move::make<PROMOTION>(to - d, to, QUEEN); //gen queen promos in captures because they are big moves
-
-			if constexpr ((t == CAPS && enemy) || (t == QUIETS && !enemy) || all) {
-				*move_list++ = move::make<PROMOTION>(to - d, to, ROOK);
-				*move_list++ = move::make<PROMOTION>(to - d, to, BISHOP);
-				*move_list++ = move::make<PROMOTION>(to - d, to, KNIGHT);
-			}
-			return move_list;
-		}
-		
+		//count-only versions of the generators in move_gen.h, used at perft leaves and for mobility
+		//instead of storing every move we popcount the target sets, so a piece costs one pop_count instead of one store per move
+		//mask is used to keep pinned pieces on the line to their king when counting legal moves, ~0 otherwise
 		template<color us, gen_type t>
-		ext_move* generate_pawn_moves(const position& pos, ext_move* move_list, bb target) {
+		int count_pawn_moves(const position& pos, bb pawns, bb target, bb mask) {
 			constexpr color them = ~us;
 			constexpr bb rank_7_bb = (us == WHITE ? RANK7BB : RANK2BB);
 			constexpr bb rank_3_bb = (us == WHITE ? RANK3BB : RANK6BB);
 			constexpr direction up = pawn_push(us);
 			constexpr direction up_r = (us == WHITE ? NORTH_EAST : SOUTH_WEST);
 			constexpr direction up_l = (us == WHITE ? NORTH_WEST : SOUTH_EAST);
+			constexpr bool all = t == EVASIONS || t == NON_EVASIONS;
+
+			//same multipliers as make_promotions(), captures give 4 pieces unless its a quiet gen, pushes give a queen in captures and the rest in quiets
+			constexpr int cap_promos = t == QUIETS ? 0 : 4;
+			constexpr int push_promos = all ? 4 : t == CAPS ? 1 : 3;
 
 			const bb empty_squares = ~pos.pieces();
-			const bb enemies = t == EVASIONS ? pos.checkers() : pos.pieces(them); //if its an evading move you only need to look at checkers
+			const bb enemies = (t == EVASIONS ? pos.checkers() : pos.pieces(them)) & target & mask;
 
-			bb pawns_on_7 = pos.pieces(us, PAWN) & rank_7_bb;
-			bb pawns_not_on_7 = pos.pieces(us, PAWN) & ~rank_7_bb;
+			bb pawns_on_7 = pawns & rank_7_bb;
+			bb pawns_not_on_7 = pawns & ~rank_7_bb;
+			int cnt = 0;
 
-			if constexpr (t != CAPS) { //handle single and double pushes
-				bb b1 = shift<up>(pawns_not_on_7) & empty_squares; //& with empty squares so that pawns shifting into pieces will become 0s
-				bb b2 = shift<up>(b1 & rank_3_bb) & empty_squares; //pawns who havent moved on the first bb move one space, and now they move again because they can
+			if constexpr (t != CAPS) {
+				bb b1 = shift<up>(pawns_not_on_7) & empty_squares;
+				bb b2 = shift<up>(b1 & rank_3_bb) & empty_squares;
 
-				if constexpr (t == EVASIONS) { //consider only blocking moves
+				if constexpr (t == EVASIONS) {
 					b1 &= target;
 					b2 &= target;
 				}
 
-				while (b1) {
-					square to = pop_lsb(b1);
-					*move_list++ = move(to - up, to); //step back one square to find original
-				}
-				while (b2) {
-					square to = pop_lsb(b2);
-					*move_list++ = move(to - up - up, to);
-				}
+				cnt += pop_count(b1 & mask) + pop_count(b2 & mask);
 			}
 
-			if (pawns_on_7) { //promotions
-				bb b1 = shift<up_r>(pawns_on_7) & enemies;
-				bb b2 = shift<up_l>(pawns_on_7) & enemies;
-				bb b3 = shift<up>(pawns_on_7) & empty_squares;
+			if (pawns_on_7) {
+				bb b3 = shift<up>(pawns_on_7) & empty_squares & mask;
 
-				if constexpr (t == EVASIONS) //you never know
+				if constexpr (t == EVASIONS)
 					b3 &= target;
 
-				while (b1)
-					move_list = make_promotions<t, up_r, true>(move_list, pop_lsb(b1));
-
-				while (b2)
-					move_list = make_promotions<t, up_l, true>(move_list, pop_lsb(b2));
-
-				while (b3)
-					move_list = make_promotions<t, up, false>(move_list, pop_lsb(b3));
+				cnt += cap_promos * (pop_count(shift<up_r>(pawns_on_7) & enemies) + pop_count(shift<up_l>(pawns_on_7) & enemies));
+				cnt += push_promos * pop_count(b3);
 			}
 
-			if constexpr (t == CAPS || t == EVASIONS || t == NON_EVASIONS) { //normal captures and en passant
-				bb b1 = shift<up_r>(pawns_not_on_7) & enemies;
-				bb b2 = shift<up_l>(pawns_not_on_7) & enemies;
-
-				while (b1) {
-					square to = pop_lsb(b1);
-					*move_list++ = move(to - up_r, to);
-				}
-				while (b2) {
-					square to = pop_lsb(b2);
-					*move_list++ = move(to - up_l, to);
-				}
-
-				if (pos.ep_square() != SQ_NONE) {
-					assert(rank_of(pos.ep_square()) == relative_rank(us, RANK_6)); //make sure en_pasasnt is in a place it can actually happen, otherwise things are bad
-
-					if (t == EVASIONS && (target * (pos.ep_square() + up))) //capture cannot resolve discoverd check
-						return move_list;
-
-					b1 = pawns_not_on_7 & pawn_attacks_bb(them, pos.ep_square());
-
-					assert(b1);
-
-					while (b1)
-						*move_list++ = move::make<EN_PASSANT>(pop_lsb(b1), pos.ep_square());
-				}
-			}
+			if constexpr (t == CAPS || t == EVASIONS || t == NON_EVASIONS) //en passant is counted seperately in count_all()
+				cnt += pop_count(shift<up_r>(pawns_not_on_7) & enemies) + pop_count(shift<up_l>(pawns_not_on_7) & enemies);
 
-			return move_list;
+			return cnt;
 		}
 
 		template<color us, piece_type p>
-		ext_move* generate_moves(const position& pos, ext_move* move_list, bb target) {
-			static_assert(p != KING && p != PAWN, "UNSUPPORTED PIECE TYPE IN GENERATE_MOVES()"); //dont use this for kings or pawns 
+		int count_piece_moves(const position& pos, bb b, bb target) {
+			static_assert(p != KING && p != PAWN, "UNSUPPORTED PIECE TYPE IN COUNT_PIECE_MOVES()");
 
-			bb b = pos.pieces(us, p);
-
-			while (b) {
-				square from = pop_lsb(b);
-				bb _b = attacks_bb<p>(from, pos.pieces()) & target;
-
-				while (_b)
-					*move_list++ = move(from, pop_lsb(_b));
-			}
+			int cnt = 0;
+			while (b)
+				cnt += pop_count(attacks_bb<p>(pop_lsb(b), pos.pieces()) & target);
 
-			return move_list;
+			return cnt;
 		}
 
-		template<color us, gen_type t>
-		ext_move* generate_all(const position& pos, ext_move* move_list) {
-			static_assert(t != LEGAL, "UNSUPPORTED TYPE IN GENERATE_ALL()");
+		//when legal is set t has to be EVASIONS or NON_EVASIONS and pinned pieces, king moves, en passant and castling are filtered exactly like generate<LEGAL>
+		template<color us, gen_type t, bool legal>
+		int count_all(const position& pos) {
+			static_assert(t != LEGAL, "UNSUPPORTED TYPE IN COUNT_ALL()");
+			static_assert(!legal || t == EVASIONS || t == NON_EVASIONS, "LEGAL COUNTS ARE BUILT FROM EVASIONS OR NON_EVASIONS");
 
+			constexpr color them = ~us;
 			const square ks = pos._square<KING>(us);
-			bb target;
+			int cnt = 0;
 
-			//dont gen non king moves in double check
 			if (t != EVASIONS || !more_than_one(pos.checkers())) {
-				//in order, set target bb to either the line between the king and the checker, all the squares friendly pieces are NOT on, all the squares enemy piece are on, or squares without any pieces (quiet moves)
-				target = t == EVASIONS ? between_bb(ks, lsb(pos.checkers())) : t == NON_EVASIONS ? ~pos.pieces(us) : t == CAPS ? pos.pieces(~us) : ~pos.pieces();
-				
-				move_list = generate_pawn_moves<us, t>(pos, move_list, target);
-				move_list = generate_moves<us, KNIGHT>(pos, move_list, target);
-				move_list = generate_moves<us, BISHOP>(pos, move_list, target);
-				move_list = generate_moves<us, ROOK>(pos, move_list, target);
-				move_list = generate_moves<us, QUEEN>(pos, move_list, target);
+				const bb target = t == EVASIONS ? between_bb(ks, lsb(pos.checkers())) : t == NON_EVASIONS ? ~pos.pieces(us) : t == CAPS ? pos.pieces(them) : ~pos.pieces();
+				const bb pinned = legal ? pos.blockers_for_king(us) & pos.pieces(us) : 0;
+				const bb pawns = pos.pieces(us, PAWN);
+
+				cnt += count_pawn_moves<us, t>(pos, pawns & ~pinned, target, ~bb(0));
+				cnt += count_piece_moves<us, KNIGHT>(pos, pos.pieces(us, KNIGHT) & ~pinned, target); //pinned knights can never move
+				cnt += count_piece_moves<us, BISHOP>(pos, pos.pieces(us, BISHOP) & ~pinned, target);
+				cnt += count_piece_moves<us, ROOK>(pos, pos.pieces(us, ROOK) & ~pinned, target);
+				cnt += count_piece_moves<us, QUEEN>(pos, pos.pieces(us, QUEEN) & ~pinned, target);
+
+				//pinned pieces can only slide along the pin, these are rare so doing them one at a time is fine
+				for (bb b = pinned & ~pos.pieces(KNIGHT); b;) {
+					square from = pop_lsb(b);
+					bb line = line_bb(ks, from);
+
+					if (type_of(pos.piece_on(from)) == PAWN)
+						cnt += count_pawn_moves<us, t>(pos, square_bb(from), target, line);
+					else
+						cnt += pop_count(attacks_bb(type_of(pos.piece_on(from)), from, pos.pieces()) & target & line);
+				}
+
+				//en passant is too weird to count with masks, there are at most two of them so just check each one
+				if ((t == CAPS || t == EVASIONS || t == NON_EVASIONS) && pos.ep_square() != SQ_NONE
+					&& !(t == EVASIONS && (target & (pos.ep_square() + pawn_push(us))))) {
+					for (bb b = pawns & ~(us == WHITE ? RANK7BB : RANK2BB) & pawn_attacks_bb(them, pos.ep_square()); b;) {
+						move m = move::make<EN_PASSANT>(pop_lsb(b), pos.ep_square());
+						cnt += !legal || pos.legal(m);
+					}
+				}
 			}
 
-			bb b = attacks_bb<KING>(ks) & (t == EVASIONS ? ~pos.pieces(us) : target);
+			bb b = attacks_bb<KING>(ks) & (t == EVASIONS || t == NON_EVASIONS ? ~pos.pieces(us) : t == CAPS ? pos.pieces(them) : ~pos.pieces());
 
-			while (b)
-				*move_list++ = move(ks, pop_lsb(b));
+			if constexpr (legal) {
+				while (b)
+					cnt += !pos.attackers_to_exist(pop_lsb(b), pos.pieces() ^ ks, them);
+			}
+			else
+				cnt += pop_count(b);
 
 			if ((t == QUIETS || t == NON_EVASIONS) && pos.can_castle(us & ANY_CASTLING)) {
-				for (castling_rights cr : {us& KING_SIDE, us& QUEEN_SIDE}) {
+				for (castling_rights cr : {us & KING_SIDE, us & QUEEN_SIDE}) {
 					if (!pos.castling_impeded(cr) && pos.can_castle(cr))
-						*move_list++ = move::make<CASTLING>(ks, pos.castling_rook_square(cr));
+						cnt += !legal || pos.legal(move::make<CASTLING>(ks, pos.castling_rook_square(cr)));
 				}
 			}
 
-			return move_list;
+			return cnt;
 		}
 	} //end of anonymous namespace
 
@@ -161,11 +136,14 @@ namespace engine {
 	template<gen_type t>
 	ext_move* generate(const position& pos, ext_move* move_list) {
 		static_assert(t != LEGAL, "UNSUPPORTED TYPE IN GENERATE()");
-		assert((t == EVASIONS) == bool(pos.checkers())); //if its an evading move there needs to be a checker, otherwise things are bad
 
-		color us = pos.side_to_move();
+		auto store = [&move_list](move m) {
+			*move_list++ = m;
+			return false;
+		};
 
-		return us == WHITE ? generate_all<WHITE, t>(pos, move_list) : generate_all<BLACK, t>(pos, move_list);
+		detail::generate_pseudo<t>(pos, store);
+		return move_list;
 	}
 
 	//explicitly declare template instantiations 
@@ -195,4 +173,27 @@ namespace engine {
 		}
 		return move_list;
 	}
-}
\ No newline at end of file
+
+	//number of moves generate<t>() would give, without writing any of them
+	template<gen_type t>
+	int count_moves(const position& pos) {
+		static_assert(t != LEGAL, "UNSUPPORTED TYPE IN COUNT_MOVES()");
+		assert((t == EVASIONS) == bool(pos.checkers()));
+
+		return pos.side_to_move() == WHITE ? count_all<WHITE, t, false>(pos) : count_all<BLACK, t, false>(pos);
+	}
+
+	template int count_moves<CAPS>(const position&);
+	template int count_moves<QUIETS>(const position&);
+	template int count_moves<EVASIONS>(const position&);
+	template int count_moves<NON_EVASIONS>(const position&);
+
+	//same as move_list<LEGAL>(pos).size() but much cheaper, this is what perft uses at the leaves
+	template<>
+	int count_moves<LEGAL>(const position& pos) {
+		if (pos.side_to_move() == WHITE)
+			return pos.checkers() ? count_all<WHITE, EVASIONS, true>(pos) : count_all<WHITE, NON_EVASIONS, true>(pos);
+		else
+			return pos.checkers() ? count_all<BLACK, EVASIONS, true>(pos) : count_all<BLACK, NON_EVASIONS, true>(pos);
+	}
+}
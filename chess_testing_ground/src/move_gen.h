@@ -3,12 +3,14 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <type_traits>
 
+#include "bitboard.h"
+#include "position.h"
 #include "types.h"
 
 
 namespace engine {
-	class position;
 
 	enum gen_type {
 		CAPS,
@@ -31,6 +33,222 @@ namespace engine {
 	template<gen_type>
 	ext_move* generate(const position& pos, ext_move* move_list);
 
+	//how many moves generate<t>() would produce, done with pop_counts instead of writing out a move list
+	template<gen_type>
+	int count_moves(const position& pos);
+
+	//the generators themselves, they hand every move to visit(m) which returns true to stop generating
+	//they live in the header so that a visitor gets inlined into the loops, generate(pos, ext_move*) is the same code with a visitor that just stores
+	namespace detail {
+		template<gen_type t, direction d, bool enemy, typename F>
+		inline bool make_promotions(F& visit, [[maybe_unused]] square to) { //saw this in stockfish, maybe_unused supressed compiler warnings saying that a variable isn't used in function body
+			constexpr bool all = t == EVASIONS || t == NON_EVASIONS;
+
+			if constexpr (t == CAPS || all)
+				if (visit(move::make<PROMOTION>(to - d, to, QUEEN))) //gen queen promos in captures because they are big moves
+					return true;
+
+			if constexpr ((t == CAPS && enemy) || (t == QUIETS && !enemy) || all) {
+				if (visit(move::make<PROMOTION>(to - d, to, ROOK))
+					|| visit(move::make<PROMOTION>(to - d, to, BISHOP))
+					|| visit(move::make<PROMOTION>(to - d, to, KNIGHT)))
+					return true;
+			}
+			return false;
+		}
+
+		template<color us, gen_type t, typename F>
+		inline bool generate_pawn_moves(const position& pos, F& visit, bb target) {
+			constexpr color them = ~us;
+			constexpr bb rank_7_bb = (us == WHITE ? RANK7BB : RANK2BB);
+			constexpr bb rank_3_bb = (us == WHITE ? RANK3BB : RANK6BB);
+			constexpr direction up = pawn_push(us);
+			constexpr direction up_r = (us == WHITE ? NORTH_EAST : SOUTH_WEST);
+			constexpr direction up_l = (us == WHITE ? NORTH_WEST : SOUTH_EAST);
+
+			const bb empty_squares = ~pos.pieces();
+			const bb enemies = t == EVASIONS ? pos.checkers() : pos.pieces(them); //if its an evading move you only need to look at checkers
+
+			bb pawns_on_7 = pos.pieces(us, PAWN) & rank_7_bb;
+			bb pawns_not_on_7 = pos.pieces(us, PAWN) & ~rank_7_bb;
+
+			if constexpr (t != CAPS) { //handle single and double pushes
+				bb b1 = shift<up>(pawns_not_on_7) & empty_squares; //& with empty squares so that pawns shifting into pieces will become 0s
+				bb b2 = shift<up>(b1 & rank_3_bb) & empty_squares; //pawns who havent moved on the first bb move one space, and now they move again because they can
+
+				if constexpr (t == EVASIONS) { //consider only blocking moves
+					b1 &= target;
+					b2 &= target;
+				}
+
+				while (b1) {
+					square to = pop_lsb(b1);
+					if (visit(move(to - up, to))) //step back one square to find original
+						return true;
+				}
+				while (b2) {
+					square to = pop_lsb(b2);
+					if (visit(move(to - up - up, to)))
+						return true;
+				}
+			}
+
+			if (pawns_on_7) { //promotions
+				bb b1 = shift<up_r>(pawns_on_7) & enemies;
+				bb b2 = shift<up_l>(pawns_on_7) & enemies;
+				bb b3 = shift<up>(pawns_on_7) & empty_squares;
+
+				if constexpr (t == EVASIONS) //you never know
+					b3 &= target;
+
+				while (b1)
+					if (make_promotions<t, up_r, true>(visit, pop_lsb(b1)))
+						return true;
+
+				while (b2)
+					if (make_promotions<t, up_l, true>(visit, pop_lsb(b2)))
+						return true;
+
+				while (b3)
+					if (make_promotions<t, up, false>(visit, pop_lsb(b3)))
+						return true;
+			}
+
+			if constexpr (t == CAPS || t == EVASIONS || t == NON_EVASIONS) { //normal captures and en passant
+				bb b1 = shift<up_r>(pawns_not_on_7) & enemies;
+				bb b2 = shift<up_l>(pawns_not_on_7) & enemies;
+
+				while (b1) {
+					square to = pop_lsb(b1);
+					if (visit(move(to - up_r, to)))
+						return true;
+				}
+				while (b2) {
+					square to = pop_lsb(b2);
+					if (visit(move(to - up_l, to)))
+						return true;
+				}
+
+				if (pos.ep_square() != SQ_NONE) {
+					assert(rank_of(pos.ep_square()) == relative_rank(us, RANK_6)); //make sure en_pasasnt is in a place it can actually happen, otherwise things are bad
+
+					if (t == EVASIONS && (target & (pos.ep_square() + up))) //capture cannot resolve discoverd check
+						return false;
+
+					b1 = pawns_not_on_7 & pawn_attacks_bb(them, pos.ep_square());
+
+					assert(b1);
+
+					while (b1)
+						if (visit(move::make<EN_PASSANT>(pop_lsb(b1), pos.ep_square())))
+							return true;
+				}
+			}
+
+			return false;
+		}
+
+		template<color us, piece_type p, typename F>
+		inline bool generate_moves(const position& pos, F& visit, bb target) {
+			static_assert(p != KING && p != PAWN, "UNSUPPORTED PIECE TYPE IN GENERATE_MOVES()"); //dont use this for kings or pawns 
+
+			bb b = pos.pieces(us, p);
+
+			while (b) {
+				square from = pop_lsb(b);
+				bb _b = attacks_bb<p>(from, pos.pieces()) & target;
+
+				while (_b)
+					if (visit(move(from, pop_lsb(_b))))
+						return true;
+			}
+
+			return false;
+		}
+
+		template<color us, gen_type t, typename F>
+		inline bool generate_all(const position& pos, F& visit) {
+			static_assert(t != LEGAL, "UNSUPPORTED TYPE IN GENERATE_ALL()");
+
+			const square ks = pos._square<KING>(us);
+			bb target;
+
+			//dont gen non king moves in double check
+			if (t != EVASIONS || !more_than_one(pos.checkers())) {
+				//in order, set target bb to either the line between the king and the checker, all the squares friendly pieces are NOT on, all the squares enemy piece are on, or squares without any pieces (quiet moves)
+				target = t == EVASIONS ? between_bb(ks, lsb(pos.checkers())) : t == NON_EVASIONS ? ~pos.pieces(us) : t == CAPS ? pos.pieces(~us) : ~pos.pieces();
+
+				if (generate_pawn_moves<us, t>(pos, visit, target)
+					|| generate_moves<us, KNIGHT>(pos, visit, target)
+					|| generate_moves<us, BISHOP>(pos, visit, target)
+					|| generate_moves<us, ROOK>(pos, visit, target)
+					|| generate_moves<us, QUEEN>(pos, visit, target))
+					return true;
+			}
+
+			bb b = attacks_bb<KING>(ks) & (t == EVASIONS ? ~pos.pieces(us) : target);
+
+			while (b)
+				if (visit(move(ks, pop_lsb(b))))
+					return true;
+
+			if ((t == QUIETS || t == NON_EVASIONS) && pos.can_castle(us & ANY_CASTLING)) {
+				for (castling_rights cr : {us & KING_SIDE, us & QUEEN_SIDE}) {
+					if (!pos.castling_impeded(cr) && pos.can_castle(cr) && visit(move::make<CASTLING>(ks, pos.castling_rook_square(cr))))
+						return true;
+				}
+			}
+
+			return false;
+		}
+
+		template<gen_type t, typename F>
+		inline bool generate_pseudo(const position& pos, F& visit) {
+			static_assert(t != LEGAL, "UNSUPPORTED TYPE IN GENERATE_PSEUDO()");
+			assert((t == EVASIONS) == bool(pos.checkers())); //if its an evading move there needs to be a checker, otherwise things are bad
+
+			return pos.side_to_move() == WHITE ? generate_all<WHITE, t>(pos, visit) : generate_all<BLACK, t>(pos, visit);
+		}
+	}
+
+	//visitor version of generate(), calls visitor(m) for every move without building a move list
+	//if the visitor returns true generation stops right there, visitors returning void see every move
+	//returns true if the visitor stopped it early, so generate<LEGAL>(pos, [](move) { return true; }) is "is there a legal move"
+	template<gen_type t, typename F, std::enable_if_t<std::is_invocable_v<F&, move>, int> = 0>
+	inline bool generate(const position& pos, F&& visitor) {
+		auto visit = [&visitor](move m) -> bool {
+			if constexpr (std::is_void_v<std::invoke_result_t<F&, move>>) {
+				visitor(m);
+				return false;
+			}
+			else
+				return visitor(m);
+		};
+
+		if constexpr (t == LEGAL) {
+			const color us = pos.side_to_move();
+			const bb pinned = pos.blockers_for_king(us) & pos.pieces(us);
+			const square ks = pos._square<KING>(us);
+
+			//same filter as generate<LEGAL>(pos, move_list), only the moves that can be illegal get checked
+			auto legal_visit = [&](move m) -> bool {
+				if (((pinned & m.from_sq()) || m.from_sq() == ks || m.type_of() == EN_PASSANT) && !pos.legal(m))
+					return false;
+				return visit(m);
+			};
+
+			return pos.checkers() ? detail::generate_pseudo<EVASIONS>(pos, legal_visit) : detail::generate_pseudo<NON_EVASIONS>(pos, legal_visit);
+		}
+		else
+			return detail::generate_pseudo<t>(pos, visit);
+	}
+
+	//cheapest way to ask if the side to move has any legal move, stops at the first one found
+	//no legal moves and in check is mate, no legal moves and not in check is stalemate
+	inline bool has_legal_moves(const position& pos) {
+		return generate<LEGAL>(pos, [](move) { return true; });
+	}
+
 
 	//saw something like this in stockfish
 	//wraps the generate() function and gives a list of moves back
@@ -0,0 +1,201 @@
+#include "movepick.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "bitboard.h"
+
+namespace engine {
+	namespace {
+		enum stages {
+			//main search
+			MAIN_TT,
+			CAPTURE_INIT,
+			GOOD_CAPTURE,
+			REFUTATION,
+			QUIET_INIT,
+			QUIET,
+			BAD_CAPTURE,
+
+			//in check
+			EVASION_TT,
+			EVASION_INIT,
+			EVASION,
+
+			//qsearch
+			QSEARCH_TT,
+			QCAPTURE_INIT,
+			QCAPTURE
+		};
+
+		//sorts the moves with value >= limit to the front in descending order, the rest stay in whatever order they were in
+		//sorting everything is a waste, most of the tail never gets looked at
+		void partial_insertion_sort(ext_move* begin, ext_move* end, int limit) {
+			for (ext_move *sorted_end = begin, *p = begin + 1; p < end; ++p) {
+				if (p->value >= limit) {
+					ext_move tmp = *p, *q;
+					*p = *++sorted_end;
+					for (q = sorted_end; q != begin && *(q - 1) < tmp; --q)
+						*q = *(q - 1);
+					*q = tmp;
+				}
+			}
+		}
+	}
+
+	move_picker::move_picker(const position& p, move ttm, int d, const butterfly_history* mh, const capture_history* cph,
+		const piece_to_history** ch, const move* killers, move counter_move) :
+		pos(p), main_history(mh), capture_hist(cph), cont_hist(ch), tt_move(ttm), depth(d) {
+		assert(d > 0);
+
+		refutations[0] = killers[0];
+		refutations[1] = killers[1] != killers[0] ? killers[1] : move::none();
+		refutations[2] = counter_move;
+
+		stage = (pos.checkers() ? EVASION_TT : MAIN_TT) + !(ttm && pos.psuedo_legal(ttm));
+	}
+
+	move_picker::move_picker(const position& p, move ttm, int d, const butterfly_history* mh, const capture_history* cph,
+		const piece_to_history** ch) :
+		pos(p), main_history(mh), capture_hist(cph), cont_hist(ch), tt_move(ttm), depth(d) {
+		assert(d <= 0);
+
+		//qsearch only plays captures, so a quiet tt move is no use here
+		stage = (pos.checkers() ? EVASION_TT : QSEARCH_TT) + !(ttm && (pos.checkers() || pos.capture_stage(ttm)) && pos.psuedo_legal(ttm));
+	}
+
+	//captures by mvv-lva: most valuable victim first, then capture history, least valuable attacker breaks what's left
+	//quiets by how often they caused cutoffs before, on their own and as a reply to the last two moves
+	template<gen_type t>
+	void move_picker::score() {
+		static_assert(t == CAPS || t == QUIETS || t == EVASIONS, "WRONG TYPE IN MOVE_PICKER::SCORE()");
+
+		const color us = pos.side_to_move();
+
+		for (auto& m : *this) {
+			const piece pc = pos.moved_piece(m);
+			const square to = m.to_sq();
+
+			if (t == CAPS || (t == EVASIONS && pos.capture_stage(m))) {
+				piece captured = m.type_of() == EN_PASSANT ? make_piece(~us, PAWN) : pos.piece_on(to);
+				m.value = 8 * piece_value[captured] - type_of(pc)
+					+ (m.type_of() == PROMOTION ? piece_value[m.promotion_type()] : 0);
+
+				if (capture_hist)
+					m.value += capture_hist->get(pc, to, type_of(captured)) / 8;
+
+				if (t == EVASIONS)
+					m.value += 1 << 28; //captures first when getting out of check
+			}
+			else {
+				m.value = main_history ? main_history->get(us, m) : 0;
+
+				if (cont_hist)
+					m.value += cont_hist[0]->get(pc, to) + (t == QUIETS ? cont_hist[1]->get(pc, to) : 0);
+			}
+		}
+	}
+
+	//returns the next move in the current stage that isn't the tt move and passes filter, none once the stage is out
+	template<typename pred>
+	move move_picker::select(pred filter) {
+		for (; cur < end_moves; ++cur) {
+			if (*cur != tt_move && filter())
+				return *cur++;
+		}
+		return move::none();
+	}
+
+	move move_picker::next_move() {
+	top:
+		switch (stage) {
+
+		case MAIN_TT:
+		case EVASION_TT:
+		case QSEARCH_TT:
+			++stage;
+			return tt_move;
+
+		case CAPTURE_INIT:
+		case QCAPTURE_INIT:
+			cur = end_bad_captures = moves;
+			end_moves = generate<CAPS>(pos, cur);
+
+			score<CAPS>();
+			partial_insertion_sort(cur, end_moves, INT32_MIN);
+			++stage;
+			goto top;
+
+		case GOOD_CAPTURE:
+			if (move m = select([&]() {
+				if (pos.see_ge(*cur))
+					return true;
+				*end_bad_captures++ = *cur; //losing capture, save it for after the quiets
+				return false;
+			}))
+				return m;
+
+			//no good captures left, set up the killers and counter move
+			cur = std::begin(refutations);
+			end_moves = std::end(refutations);
+
+			//counter move is pointless if its a killer already
+			if (refutations[0] == refutations[2] || refutations[1] == refutations[2])
+				--end_moves;
+
+			++stage;
+			[[fallthrough]];
+
+		case REFUTATION:
+			if (move m = select([&]() { return *cur != move::none() && !pos.capture_stage(*cur) && pos.psuedo_legal(*cur); }))
+				return m;
+			++stage;
+			[[fallthrough]];
+
+		case QUIET_INIT:
+			if (!skip_quiets) {
+				cur = end_bad_captures;
+				end_moves = generate<QUIETS>(pos, cur);
+
+				score<QUIETS>();
+				partial_insertion_sort(cur, end_moves, -3000 * depth);
+			}
+			++stage;
+			[[fallthrough]];
+
+		case QUIET:
+			if (!skip_quiets) {
+				if (move m = select([&]() { return *cur != refutations[0] && *cur != refutations[1] && *cur != refutations[2]; }))
+					return m;
+			}
+
+			//go back over the losing captures
+			cur = moves;
+			end_moves = end_bad_captures;
+
+			++stage;
+			[[fallthrough]];
+
+		case BAD_CAPTURE:
+			return select([]() { return true; });
+
+		case EVASION_INIT:
+			cur = moves;
+			end_moves = generate<EVASIONS>(pos, cur);
+
+			score<EVASIONS>();
+			partial_insertion_sort(cur, end_moves, INT32_MIN);
+			++stage;
+			[[fallthrough]];
+
+		case EVASION:
+		case QCAPTURE:
+			return select([]() { return true; });
+		}
+
+		assert(false);
+		return move::none();
+	}
+
+	void move_picker::skip_quiet_moves() { skip_quiets = true; }
+}
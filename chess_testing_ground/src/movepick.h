@@ -0,0 +1,52 @@
+#ifndef MOVEPICK_H_INC
+#define MOVEPICK_H_INC
+
+#include "history.h"
+#include "move_gen.h"
+#include "position.h"
+#include "types.h"
+
+namespace engine {
+
+	//hands out pseudo legal moves one at a time, most promising first, and only generates a stage when the one before it runs out
+	//order is tt move, good captures (mvv-lva, kept if see_ge passes), killers and counter move, quiets by history, then losing captures
+	//most nodes cut off on the tt move or a capture, so the quiet stage (where most of the moves are) usually never gets generated
+	class move_picker {
+	public:
+		move_picker(const move_picker&) = delete;
+		move_picker& operator=(const move_picker&) = delete;
+
+		//main search, ch is the continuation history rows of the last two plies
+		move_picker(const position& p, move ttm, int d, const butterfly_history* mh, const capture_history* cph,
+			const piece_to_history** ch, const move* killers, move counter_move);
+		//qsearch, only captures (and queen promos) unless in check
+		move_picker(const position& p, move ttm, int d, const butterfly_history* mh, const capture_history* cph,
+			const piece_to_history** ch);
+
+		move next_move();
+		void skip_quiet_moves(); //rest of the quiets get skipped, bad captures still come out
+		bool quiets_skipped() const { return skip_quiets; }
+
+	private:
+		template<typename pred>
+		move select(pred filter);
+		template<gen_type t>
+		void score();
+		ext_move* begin() { return cur; }
+		ext_move* end() { return end_moves; }
+
+		const position& pos;
+		const butterfly_history* main_history;
+		const capture_history* capture_hist;
+		const piece_to_history** cont_hist;
+		move tt_move;
+		ext_move refutations[3]; //two killers and the counter move
+		ext_move *cur, *end_moves, *end_bad_captures;
+		int stage;
+		int depth;
+		bool skip_quiets = false;
+		ext_move moves[MAX_MOVES];
+	};
+}
+
+#endif
@@ -0,0 +1,530 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef NOMINMAX
+#define NOMINMAX //windows.h min/max macros would break std::min in the headers below
+#endif
+#include <windows.h>
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#define USE_AVX512
+#endif
+#if defined(__AVX2__)
+#define USE_AVX2
+#endif
+#if defined(__SSE4_1__) || defined(USE_AVX2)
+#define USE_SSE41
+#endif
+
+#if defined(USE_SSE41)
+#include <immintrin.h>
+#endif
+
+#include "memory.h"
+#include "position.h"
+#include "utils.h"
+
+namespace engine {
+	namespace {
+		using namespace nnue;
+
+		constexpr uint32_t VERSION = 0x7AF32F16;
+
+		//where each piece's 64 squares start in a king's feature block, from each side's point of view
+		//white's pawns are "ours" for white and "theirs" for black, so the same piece lands in a different block per perspective
+		enum : int {
+			PS_W_PAWN = 1, PS_B_PAWN = 1 * SQUARE_NB + 1,
+			PS_W_KNIGHT = 2 * SQUARE_NB + 1, PS_B_KNIGHT = 3 * SQUARE_NB + 1,
+			PS_W_BISHOP = 4 * SQUARE_NB + 1, PS_B_BISHOP = 5 * SQUARE_NB + 1,
+			PS_W_ROOK = 6 * SQUARE_NB + 1, PS_B_ROOK = 7 * SQUARE_NB + 1,
+			PS_W_QUEEN = 8 * SQUARE_NB + 1, PS_B_QUEEN = 9 * SQUARE_NB + 1
+		};
+
+		constexpr int piece_index[PIECE_NB][COLOR_NB] = {
+			{ 0, 0 }, { PS_W_PAWN, PS_B_PAWN }, { PS_W_KNIGHT, PS_B_KNIGHT }, { PS_W_BISHOP, PS_B_BISHOP },
+			{ PS_W_ROOK, PS_B_ROOK }, { PS_W_QUEEN, PS_B_QUEEN }, { 0, 0 }, { 0, 0 },
+			{ 0, 0 }, { PS_B_PAWN, PS_W_PAWN }, { PS_B_KNIGHT, PS_W_KNIGHT }, { PS_B_BISHOP, PS_W_BISHOP },
+			{ PS_B_ROOK, PS_W_ROOK }, { PS_B_QUEEN, PS_W_QUEEN }, { 0, 0 }, { 0, 0 } };
+
+		//black sees the board rotated so both perspectives share one set of weights
+		inline int orient(color perspective, square s) { return int(s) ^ (perspective == WHITE ? 0 : 63); }
+
+		inline int feature_index(color perspective, square ksq, piece pc, square s) {
+			return orient(perspective, s) + piece_index[pc][perspective] + PS_END * orient(perspective, ksq);
+		}
+
+		struct network {
+			int16_t* ft_weights = nullptr; //INPUT_DIMS rows of HALF_DIMS, ~21mb so it gets large pages
+			alignas(64) int16_t ft_biases[HALF_DIMS];
+			alignas(64) int32_t l1_biases[L1_OUT];
+			alignas(64) int8_t l1_weights[L1_OUT * L1_IN];
+#if defined(USE_AVX2)
+			alignas(64) int8_t l1_weights_by_chunk[L1_IN / 4][L1_OUT * 4]; //l1_weights regrouped for the sparse kernel
+#endif
+			alignas(64) int32_t l2_biases[L2_OUT];
+			alignas(64) int8_t l2_weights[L2_OUT * L1_OUT];
+			int32_t out_bias;
+			alignas(64) int8_t out_weights[L2_OUT];
+		};
+
+		network net;
+		bool net_loaded = false;
+
+		//kernels, widest instruction set the build allows, scalar if none
+
+#if defined(USE_AVX512)
+		using vec_t = __m512i;
+		inline vec_t vec_load(const void* p) { return _mm512_load_si512(p); }
+		inline void vec_store(void* p, vec_t v) { _mm512_store_si512(p, v); }
+		inline vec_t vec_add_16(vec_t a, vec_t b) { return _mm512_add_epi16(a, b); }
+		inline vec_t vec_sub_16(vec_t a, vec_t b) { return _mm512_sub_epi16(a, b); }
+#elif defined(USE_AVX2)
+		using vec_t = __m256i;
+		inline vec_t vec_load(const void* p) { return _mm256_load_si256(static_cast<const vec_t*>(p)); }
+		inline void vec_store(void* p, vec_t v) { _mm256_store_si256(static_cast<vec_t*>(p), v); }
+		inline vec_t vec_add_16(vec_t a, vec_t b) { return _mm256_add_epi16(a, b); }
+		inline vec_t vec_sub_16(vec_t a, vec_t b) { return _mm256_sub_epi16(a, b); }
+#elif defined(USE_SSE41)
+		using vec_t = __m128i;
+		inline vec_t vec_load(const void* p) { return _mm_load_si128(static_cast<const vec_t*>(p)); }
+		inline void vec_store(void* p, vec_t v) { _mm_store_si128(static_cast<vec_t*>(p), v); }
+		inline vec_t vec_add_16(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+		inline vec_t vec_sub_16(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+#endif
+
+		//out = in + added rows - removed rows, one pass over the accumulator no matter how many rows change
+		void update_half(int16_t* out, const int16_t* in, const int* added, int add_count, const int* removed, int rem_count) {
+#if defined(USE_SSE41)
+			constexpr int lanes = sizeof(vec_t) / sizeof(int16_t);
+
+			for (int j = 0; j < HALF_DIMS; j += lanes) {
+				vec_t v = vec_load(in + j);
+				for (int i = 0; i < add_count; i++)
+					v = vec_add_16(v, vec_load(net.ft_weights + added[i] * HALF_DIMS + j));
+				for (int i = 0; i < rem_count; i++)
+					v = vec_sub_16(v, vec_load(net.ft_weights + removed[i] * HALF_DIMS + j));
+				vec_store(out + j, v);
+			}
+#else
+			for (int j = 0; j < HALF_DIMS; j++) {
+				int v = in[j];
+				for (int i = 0; i < add_count; i++)
+					v += net.ft_weights[added[i] * HALF_DIMS + j];
+				for (int i = 0; i < rem_count; i++)
+					v -= net.ft_weights[removed[i] * HALF_DIMS + j];
+				out[j] = int16_t(v);
+			}
+#endif
+		}
+
+		//clamp one perspective's accumulator to [0, 127] for the int8 layers
+		void transform_half(uint8_t* out, const int16_t* in) {
+#if defined(USE_AVX512)
+			const __m512i zero = _mm512_setzero_si512();
+			const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7); //packs works per 128 bit lane
+
+			for (int j = 0; j < HALF_DIMS; j += 64) {
+				__m512i packed = _mm512_packs_epi16(vec_load(in + j), vec_load(in + j + 32));
+				vec_store(out + j, _mm512_permutexvar_epi64(order, _mm512_max_epi8(packed, zero)));
+			}
+#elif defined(USE_AVX2)
+			const __m256i zero = _mm256_setzero_si256();
+
+			for (int j = 0; j < HALF_DIMS; j += 32) {
+				__m256i packed = _mm256_packs_epi16(vec_load(in + j), vec_load(in + j + 16));
+				vec_store(out + j, _mm256_permute4x64_epi64(_mm256_max_epi8(packed, zero), 0xD8));
+			}
+#elif defined(USE_SSE41)
+			const __m128i zero = _mm_setzero_si128();
+
+			for (int j = 0; j < HALF_DIMS; j += 16)
+				vec_store(out + j, _mm_max_epi8(_mm_packs_epi16(vec_load(in + j), vec_load(in + j + 8)), zero));
+#else
+			for (int j = 0; j < HALF_DIMS; j++)
+				out[j] = uint8_t(std::clamp<int>(in[j], 0, 127));
+#endif
+		}
+
+		//uint8 inputs times int8 weights, n has to be a multiple of 32
+		int32_t dot(const uint8_t* in, const int8_t* w, int n) {
+#if defined(USE_AVX2)
+			const __m256i ones = _mm256_set1_epi16(1);
+			__m256i sum = _mm256_setzero_si256();
+
+			for (int i = 0; i < n; i += 32) {
+				__m256i prod = _mm256_maddubs_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(in + i)),
+					_mm256_load_si256(reinterpret_cast<const __m256i*>(w + i)));
+				sum = _mm256_add_epi32(sum, _mm256_madd_epi16(prod, ones));
+			}
+
+			__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+			s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+			s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+			return _mm_cvtsi128_si32(s);
+#elif defined(USE_SSE41)
+			const __m128i ones = _mm_set1_epi16(1);
+			__m128i sum = _mm_setzero_si128();
+
+			for (int i = 0; i < n; i += 16) {
+				__m128i prod = _mm_maddubs_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(in + i)),
+					_mm_load_si128(reinterpret_cast<const __m128i*>(w + i)));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(prod, ones));
+			}
+
+			sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+			sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+			return _mm_cvtsi128_si32(sum);
+#else
+			int32_t sum = 0;
+			for (int i = 0; i < n; i++)
+				sum += int32_t(in[i]) * w[i];
+			return sum;
+#endif
+		}
+
+		//affine layer followed by the clipped relu, weights are row major, one row per output
+		template<int in_dims, int out_dims>
+		void affine_relu(uint8_t* out, const uint8_t* in, const int8_t* weights, const int32_t* biases) {
+#if defined(USE_AVX2)
+			//four rows at a time so every input load is shared and the four horizontal sums collapse into one
+			static_assert(in_dims % 32 == 0 && out_dims % 4 == 0);
+
+			const __m256i ones = _mm256_set1_epi16(1);
+
+			for (int i = 0; i < out_dims; i += 4) {
+				const int8_t* w = weights + i * in_dims;
+				__m256i sum[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+				for (int j = 0; j < in_dims; j += 32) {
+					const __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(in + j));
+
+					for (int k = 0; k < 4; k++) {
+						__m256i prod = _mm256_maddubs_epi16(x, _mm256_load_si256(reinterpret_cast<const __m256i*>(w + k * in_dims + j)));
+						sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(prod, ones));
+					}
+				}
+
+				__m256i h = _mm256_hadd_epi32(_mm256_hadd_epi32(sum[0], sum[1]), _mm256_hadd_epi32(sum[2], sum[3]));
+				__m128i v = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+				v = _mm_add_epi32(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + i)));
+				v = _mm_srai_epi32(v, WEIGHT_SCALE_BITS);
+				v = _mm_packs_epi32(v, v);
+				v = _mm_max_epi8(_mm_packs_epi16(v, v), _mm_setzero_si128());
+
+				const int32_t packed = _mm_cvtsi128_si32(v);
+				std::memcpy(out + i, &packed, 4);
+			}
+#else
+			for (int i = 0; i < out_dims; i++) {
+				int32_t v = biases[i] + dot(in, weights + i * in_dims, in_dims);
+				out[i] = uint8_t(std::clamp(v >> WEIGHT_SCALE_BITS, 0, 127));
+			}
+#endif
+		}
+
+#if defined(USE_AVX2)
+		//first layer, its input is the clipped accumulator and a good part of that is zero, so only the non zero
+		//4 byte chunks get multiplied in, each one against the weights of all 32 outputs at once
+		void affine_relu_sparse(uint8_t* out, const uint8_t* in) {
+			static_assert(L1_OUT == 32 && L1_IN % 32 == 0);
+
+			const __m256i ones = _mm256_set1_epi16(1);
+			const int32_t* in32 = reinterpret_cast<const int32_t*>(in);
+			uint16_t nonzero[L1_IN / 4];
+			int count = 0;
+
+			//inputs are at most 127 so a chunk is non zero exactly when it's positive as an int32
+			for (int j = 0; j < L1_IN; j += 32) {
+				const __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(in + j));
+				unsigned mask = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, _mm256_setzero_si256()))));
+
+				while (mask) {
+					nonzero[count++] = uint16_t(j / 4 + int(lsb(mask)));
+					mask &= mask - 1;
+				}
+			}
+
+			__m256i sum[4];
+			for (int k = 0; k < 4; k++)
+				sum[k] = _mm256_load_si256(reinterpret_cast<const __m256i*>(net.l1_biases + 8 * k));
+
+			for (int i = 0; i < count; i++) {
+				const __m256i x = _mm256_set1_epi32(in32[nonzero[i]]);
+				const int8_t* w = net.l1_weights_by_chunk[nonzero[i]];
+
+				for (int k = 0; k < 4; k++) {
+					__m256i prod = _mm256_maddubs_epi16(x, _mm256_load_si256(reinterpret_cast<const __m256i*>(w + 32 * k)));
+					sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(prod, ones));
+				}
+			}
+
+			for (int k = 0; k < 4; k++)
+				sum[k] = _mm256_srai_epi32(sum[k], WEIGHT_SCALE_BITS);
+
+			//the packs interleave per 128 bit lane, the permute puts the 32 outputs back in order
+			__m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(sum[0], sum[1]), _mm256_packs_epi32(sum[2], sum[3]));
+			packed = _mm256_max_epi8(packed, _mm256_setzero_si256());
+			packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(out), packed);
+		}
+#endif
+
+		//every feature that's on for this perspective, the king itself isn't a feature
+		int active_features(const position& pos, color perspective, int* features) {
+			const square ksq = pos._square<KING>(perspective);
+			bb b = pos.pieces() & ~pos.pieces(KING);
+			int n = 0;
+
+			while (b) {
+				square s = pop_lsb(b);
+				features[n++] = feature_index(perspective, ksq, pos.piece_on(s), s);
+			}
+			return n;
+		}
+
+		void refresh_half(const position& pos, color perspective, int16_t* out) {
+			int features[32];
+			int n = active_features(pos, perspective, features);
+
+			update_half(out, net.ft_biases, features, n, nullptr, 0);
+		}
+
+		template<typename T>
+		T read(const char*& p) {
+			T v;
+			std::memcpy(&v, p, sizeof(T));
+			p += sizeof(T);
+			return v;
+		}
+
+		template<typename T>
+		void read(const char*& p, T* out, size_t count) {
+			std::memcpy(out, p, count * sizeof(T));
+			p += count * sizeof(T);
+		}
+
+		//header, feature transformer, then the layers from the input side out, every section starts with a hash we don't check
+		bool parse(const char* data, size_t size, network& n, std::string& description) {
+			const char* p = data;
+			const char* end = data + size;
+
+			if (size < 12 || read<uint32_t>(p) != VERSION)
+				return false;
+
+			read<uint32_t>(p); //hash
+			uint32_t desc_size = read<uint32_t>(p);
+
+			const size_t body = 4 + HALF_DIMS * 2 + size_t(INPUT_DIMS) * HALF_DIMS * 2
+				+ 4 + L1_OUT * 4 + L1_OUT * L1_IN + L2_OUT * 4 + L2_OUT * L1_OUT + 4 + L2_OUT;
+
+			if (size_t(end - p) != desc_size + body)
+				return false;
+
+			description.assign(p, desc_size);
+			p += desc_size;
+
+			read<uint32_t>(p);
+			read(p, n.ft_biases, HALF_DIMS);
+			read(p, n.ft_weights, size_t(INPUT_DIMS) * HALF_DIMS);
+
+			read<uint32_t>(p);
+			read(p, n.l1_biases, L1_OUT);
+			read(p, n.l1_weights, L1_OUT * L1_IN);
+			read(p, n.l2_biases, L2_OUT);
+			read(p, n.l2_weights, L2_OUT * L1_OUT);
+			n.out_bias = read<int32_t>(p);
+			read(p, n.out_weights, L2_OUT);
+
+			assert(p == end);
+
+#if defined(USE_AVX2)
+			//chunk c holds inputs 4c..4c+3 for every output, output after output
+			for (int c = 0; c < L1_IN / 4; c++)
+				for (int o = 0; o < L1_OUT; o++)
+					for (int k = 0; k < 4; k++)
+						n.l1_weights_by_chunk[c][o * 4 + k] = n.l1_weights[o * L1_IN + c * 4 + k];
+#endif
+			return true;
+		}
+	}
+
+	nnue::accumulator_stack::accumulator_stack() :
+		stack(static_cast<accumulator*>(std_aligned_alloc(alignof(accumulator), state_stack::STACK_SIZE * sizeof(accumulator)))),
+		dirty(new dirty_piece[state_stack::STACK_SIZE]),
+		finny(static_cast<finny_entry(*)[COLOR_NB]>(std_aligned_alloc(alignof(finny_entry), SQUARE_NB * sizeof(*finny)))),
+		size(1) {
+		if (!stack || !finny) {
+			std::cerr << "failed to alloc accumulator stack" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	nnue::accumulator_stack::~accumulator_stack() {
+		std_aligned_free(stack);
+		std_aligned_free(finny);
+		delete[] dirty;
+	}
+
+	void nnue::accumulator_stack::reset(const position& pos) {
+		size = 1;
+		stack[0].computed[WHITE] = stack[0].computed[BLACK] = false;
+
+		if (!net_loaded)
+			return;
+
+		//an empty board, the first refresh on each square adds every piece
+		for (int s = 0; s < SQUARE_NB; s++)
+			for (color c : { WHITE, BLACK }) {
+				std::memcpy(finny[s][c].values, net.ft_biases, sizeof(net.ft_biases));
+				std::memset(finny[s][c].pieces, 0, sizeof(finny[s][c].pieces));
+			}
+
+		update(pos);
+	}
+
+	const nnue::accumulator& nnue::accumulator_stack::update(const position& pos) {
+		assert(net_loaded);
+
+		accumulator& top = stack[size - 1];
+
+		for (color c : { WHITE, BLACK }) {
+			if (top.computed[c])
+				continue;
+
+			//look back for one that's already built, a move of this side's king on the way means starting over
+			int i = size - 1;
+			while (!stack[i].computed[c] && i > 0 && dirty[i].pc[0] != make_piece(c, KING))
+				--i;
+
+			if (!stack[i].computed[c]) {
+				refresh(pos, c);
+				continue;
+			}
+
+			//the king hasn't moved since stack[i] so every step in between uses the square it's on now
+			const square ksq = pos._square<KING>(c);
+
+			for (++i; i < size; i++) {
+				const dirty_piece& dp = dirty[i];
+				int added[3], removed[3];
+				int add_count = 0, rem_count = 0;
+
+				for (int j = 0; j < dp.count; j++) {
+					if (type_of(dp.pc[j]) == KING)
+						continue;
+					if (dp.from[j] != SQ_NONE)
+						removed[rem_count++] = feature_index(c, ksq, dp.pc[j], dp.from[j]);
+					if (dp.to[j] != SQ_NONE)
+						added[add_count++] = feature_index(c, ksq, dp.pc[j], dp.to[j]);
+				}
+
+				update_half(stack[i].values[c], stack[i - 1].values[c], added, add_count, removed, rem_count);
+				stack[i].computed[c] = true;
+			}
+		}
+
+		return top;
+	}
+
+	//top accumulator's half from the finny entry for the current king square, only the pieces that differ get applied
+	void nnue::accumulator_stack::refresh(const position& pos, color perspective) {
+		const square ksq = pos._square<KING>(perspective);
+		finny_entry& entry = finny[ksq][perspective];
+		int added[32], removed[32];
+		int add_count = 0, rem_count = 0;
+
+		for (piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN }) {
+			const bb now = pos.pieces(color_of(pc), type_of(pc));
+			bb add = now & ~entry.pieces[pc];
+			bb rem = entry.pieces[pc] & ~now;
+
+			while (add)
+				added[add_count++] = feature_index(perspective, ksq, pc, pop_lsb(add));
+			while (rem)
+				removed[rem_count++] = feature_index(perspective, ksq, pc, pop_lsb(rem));
+
+			entry.pieces[pc] = now;
+		}
+
+		update_half(entry.values, entry.values, added, add_count, removed, rem_count);
+
+		accumulator& top = stack[size - 1];
+		std::memcpy(top.values[perspective], entry.values, sizeof(entry.values));
+		top.computed[perspective] = true;
+	}
+
+	bool nnue::load(const std::string& path) {
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		const char* data = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+		//the file isn't aligned for simd loads, so weights get copied out of the mapping into our own memory
+		int16_t* weights = static_cast<int16_t*>(aligned_large_pages_alloc(size_t(INPUT_DIMS) * HALF_DIMS * sizeof(int16_t)));
+		int16_t* old_weights = net.ft_weights;
+		std::string description;
+		bool ok = false;
+
+		if (data && weights) {
+			net.ft_weights = weights;
+			ok = parse(data, size_t(size.QuadPart), net, description);
+		}
+
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+
+		if (!ok) {
+			//parse only writes into net once the size checks out, so the old net is still whole
+			net.ft_weights = old_weights;
+			aligned_large_pages_free(weights);
+			return false;
+		}
+
+		aligned_large_pages_free(old_weights);
+		net_loaded = true;
+		sync_cout << "info string loaded nnue " << path << " " << description << sync_endl;
+		return true;
+	}
+
+	bool nnue::loaded() { return net_loaded; }
+
+	int nnue::evaluate(const position& pos) {
+		assert(net_loaded);
+
+		alignas(64) uint8_t transformed[L1_IN];
+		alignas(64) uint8_t l1_out[L1_OUT];
+		alignas(64) uint8_t l2_out[L2_OUT];
+
+		const color us = pos.side_to_move();
+		const accumulator* acc = pos.accumulators() ? &pos.accumulators()->update(pos) : nullptr;
+		accumulator fresh;
+
+		if (!acc) {
+			for (color c : { WHITE, BLACK })
+				refresh_half(pos, c, fresh.values[c]);
+			acc = &fresh;
+		}
+
+		//side to move's half first
+		transform_half(transformed, acc->values[us]);
+		transform_half(transformed + HALF_DIMS, acc->values[~us]);
+
+#if defined(USE_AVX2)
+		affine_relu_sparse(l1_out, transformed);
+#else
+		affine_relu<L1_IN, L1_OUT>(l1_out, transformed, net.l1_weights, net.l1_biases);
+#endif
+		affine_relu<L1_OUT, L2_OUT>(l2_out, l1_out, net.l2_weights, net.l2_biases);
+
+		return (net.out_bias + dot(l2_out, net.out_weights, L2_OUT)) / FV_SCALE;
+	}
+}
@@ -0,0 +1,82 @@
+#ifndef NNUE_H_INC
+#define NNUE_H_INC
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+#include "position.h"
+#include "types.h"
+
+namespace engine {
+	//efficiently updatable neural network eval, halfkp[41024] -> 256x2 -> 32 -> 32 -> 1
+	//the file layout is the one the stockfish 12 era .nnue files use, so those load directly
+	//first layer is a sum of weight rows for the (king square, piece, square) features that are on, and a move only changes a couple
+	//of them, so it lives in accumulators that do_move updates instead of being recomputed per eval
+	namespace nnue {
+		constexpr int PS_END = 10 * SQUARE_NB + 1; //non king pieces of both colors on every square, index 0 isn't used
+		constexpr int INPUT_DIMS = SQUARE_NB * PS_END;
+		constexpr int HALF_DIMS = 256;
+		constexpr int L1_IN = 2 * HALF_DIMS;
+		constexpr int L1_OUT = 32;
+		constexpr int L2_OUT = 32;
+		constexpr int WEIGHT_SCALE_BITS = 6;
+		constexpr int FV_SCALE = 16;
+
+		//what a move did to the board, at most 3 pieces (castling moves two, a capturing promotion removes two and adds one)
+		struct dirty_piece {
+			int count;
+			piece pc[3];
+			square from[3]; //SQ_NONE if the piece was added
+			square to[3];   //SQ_NONE if the piece was removed
+		};
+
+		struct alignas(64) accumulator {
+			int16_t values[COLOR_NB][HALF_DIMS];
+			bool computed[COLOR_NB];
+		};
+
+		//finny table entry, the last half accumulator built with the king on this square and the board it was built from
+		//a king move then only applies the difference from that board instead of adding up every piece again
+		struct alignas(64) finny_entry {
+			int16_t values[HALF_DIMS];
+			bb pieces[PIECE_NB];
+		};
+
+		//one accumulator per ply, same idea as state_stack
+		//do_move only records what changed and undo_move pops, the accumulators get built when evaluate actually needs one,
+		//so nodes that cut off on the tt or never evaluate never pay for them
+		class accumulator_stack {
+		public:
+			accumulator_stack();
+			~accumulator_stack();
+			accumulator_stack(const accumulator_stack&) = delete;
+			accumulator_stack& operator=(const accumulator_stack&) = delete;
+
+			void reset(const position& pos); //clears the finny table and builds the root
+			void push(const dirty_piece& dp) {
+				assert(size < state_stack::STACK_SIZE);
+				dirty[size] = dp;
+				stack[size].computed[WHITE] = stack[size].computed[BLACK] = false;
+				++size;
+			}
+			void push_null() { push(dirty_piece{}); } //count 0, nothing moved
+			void pop() { assert(size > 1); --size; }
+			const accumulator& update(const position& pos); //builds the top accumulator from the nearest computed one and returns it
+
+		private:
+			void refresh(const position& pos, color perspective);
+
+			accumulator* stack;
+			dirty_piece* dirty; //dirty[i] is the move that led from stack[i - 1] to stack[i]
+			finny_entry (*finny)[COLOR_NB];
+			int size;
+		};
+
+		bool load(const std::string& path); //keeps the old net if this one fails
+		bool loaded();
+		int evaluate(const position& pos); //uses the attached accumulator stack if there is one, otherwise computes from scratch
+	}
+}
+
+#endif
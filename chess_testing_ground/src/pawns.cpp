@@ -0,0 +1,96 @@
+#include "pawns.h"
+
+#include <algorithm>
+
+namespace engine {
+	namespace {
+		//mg, eg
+		constexpr int isolated_penalty[2] = { 5, 15 };
+		constexpr int doubled_penalty[2] = { 11, 56 };
+		constexpr int passed_bonus[RANK_NB][2] = {
+			{ 0, 0 }, { 10, 28 }, { 17, 33 }, { 15, 41 }, { 62, 72 }, { 168, 177 }, { 276, 260 }, { 0, 0 } };
+		constexpr int shield_bonus[2] = { 24, 8 }; //own pawn one rank in front of the king, two ranks in front gets half
+
+		//every square in front of (and including) the pawns, from c's side
+		template<color c>
+		constexpr bb fill_forward(bb b) {
+			if constexpr (c == WHITE) {
+				b |= b << 8;
+				b |= b << 16;
+				b |= b << 32;
+			}
+			else {
+				b |= b >> 8;
+				b |= b >> 16;
+				b |= b >> 32;
+			}
+			return b;
+		}
+
+		constexpr bb fill_file(bb b) { return fill_forward<WHITE>(b) | fill_forward<BLACK>(b); }
+
+		template<color us>
+		void evaluate(const position& pos, pawns::entry* e) {
+			constexpr color them = ~us;
+			constexpr direction up = us == WHITE ? NORTH : SOUTH;
+			constexpr direction down = us == WHITE ? SOUTH : NORTH;
+
+			const bb ours = pos.pieces(us, PAWN);
+			const bb theirs = pos.pieces(them, PAWN);
+
+			//everything their pawns can still stop: the squares in front of them and the ones they will attack on the way
+			const bb their_front = fill_forward<them>(shift<down>(theirs));
+			const bb blocked = their_front | shift<EAST>(their_front) | shift<WEST>(their_front);
+
+			const bb files = fill_file(ours);
+
+			e->attacks[us] = pawn_attacks_bb<us>(ours);
+			e->passed[us] = ours & ~blocked;
+			e->isolated[us] = ours & ~(shift<EAST>(files) | shift<WEST>(files));
+			e->doubled[us] = ours & fill_forward<us>(shift<up>(ours)); //an own pawn somewhere behind
+
+			int mg = 0, eg = 0;
+
+			mg -= isolated_penalty[0] * pop_count(e->isolated[us]);
+			eg -= isolated_penalty[1] * pop_count(e->isolated[us]);
+			mg -= doubled_penalty[0] * pop_count(e->doubled[us]);
+			eg -= doubled_penalty[1] * pop_count(e->doubled[us]);
+
+			for (bb b = e->passed[us]; b;) {
+				const rank r = relative_rank(us, pop_lsb(b));
+				mg += passed_bonus[r][0];
+				eg += passed_bonus[r][1];
+			}
+
+			e->mg_score[us] = mg;
+			e->eg_score[us] = eg;
+		}
+	}
+
+	int pawns::entry::evaluate_shelter(const position& pos, color c, square ksq) {
+		const direction up = pawn_push(c);
+		const file f = std::clamp(file_of(ksq), FILE_B, FILE_G);
+		const bb files = file_bb(file(f - 1)) | file_bb(f) | file_bb(file(f + 1));
+		const bb ours = pos.pieces(c, PAWN) & files;
+
+		const bb near = relative_rank(c, ksq) < RANK_8 ? rank_bb(rank_of(ksq + up)) : 0;
+		const bb far = relative_rank(c, ksq) < RANK_7 ? rank_bb(rank_of(ksq + up + up)) : 0;
+
+		return shield_bonus[0] * pop_count(ours & near) + shield_bonus[0] / 2 * pop_count(ours & far);
+	}
+
+	pawns::entry* pawns::probe(const position& pos, table& t) {
+		const uint64_t key = pos.r_pawn_key();
+		entry* e = t[key];
+
+		if (e->key == key)
+			return e;
+
+		e->key = key;
+		e->king_square[WHITE] = e->king_square[BLACK] = SQ_NONE;
+		engine::evaluate<WHITE>(pos, e);
+		engine::evaluate<BLACK>(pos, e);
+
+		return e;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef PAWNS_H_INC
+#define PAWNS_H_INC
+
+#include "bitboard.h"
+#include "position.h"
+#include "types.h"
+#include "utils.h"
+
+namespace engine {
+	//pawn structure only changes on pawn moves and captures of pawns, so it gets evaluated once per pawn_key and cached
+	//in search the same pawn structure comes up over and over, nearly every probe is a hit
+	namespace pawns {
+		struct entry {
+			int mg(color c) const { return mg_score[c]; }
+			int eg(color c) const { return eg_score[c]; }
+			bb passed_pawns(color c) const { return passed[c]; }
+			bb pawn_attacks(color c) const { return attacks[c]; }
+
+			//pawns in front of the king, depends on where the king is so it's redone only when the king has moved
+			int king_shelter(const position& pos, color c) {
+				const square ksq = pos._square<KING>(c);
+				if (king_square[c] != ksq) {
+					king_square[c] = ksq;
+					shelter[c] = evaluate_shelter(pos, c, ksq);
+				}
+				return shelter[c];
+			}
+
+			uint64_t key;
+			bb passed[COLOR_NB];
+			bb isolated[COLOR_NB];
+			bb doubled[COLOR_NB];
+			bb attacks[COLOR_NB];
+			int mg_score[COLOR_NB];
+			int eg_score[COLOR_NB];
+			square king_square[COLOR_NB];
+			int shelter[COLOR_NB];
+
+		private:
+			static int evaluate_shelter(const position& pos, color c, square ksq);
+		};
+
+		using table = hash_table<entry, 16384>;
+
+		entry* probe(const position& pos, table& t);
+	}
+}
+
+#endif
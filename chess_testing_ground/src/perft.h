@@ -0,0 +1,38 @@
+#ifndef PERFT_H_INC
+#define PERFT_H_INC
+
+#include <cstdint>
+#include <iostream>
+
+#include "move_gen.h"
+#include "position.h"
+#include "types.h"
+#include "uci.h"
+
+namespace engine {
+
+	//counts leaf nodes of the legal move tree, used to check move gen against known numbers
+	//the last ply is never actually played, count_moves<LEGAL>() just pop_counts the targets
+	//ss is the slot in the state stack the children of this node get played into
+	template<bool root>
+	uint64_t perft(position& pos, state_info* ss, int depth) {
+		uint64_t cnt, nodes = 0;
+		const bool leaf = (depth == 2);
+
+		for (const auto& m : move_list<LEGAL>(pos)) {
+			if (root && depth <= 1)
+				cnt = 1, nodes++;
+			else {
+				pos.do_move(m, *ss);
+				cnt = leaf ? count_moves<LEGAL>(pos) : perft<false>(pos, ss + 1, depth - 1);
+				nodes += cnt;
+				pos.undo_move(m);
+			}
+			if (root)
+				std::cout << uci_engine::n_move(m) << ": " << cnt << std::endl;
+		}
+		return nodes;
+	}
+}
+
+#endif
@@ -12,6 +12,8 @@
 #include "bitboard.h"
 #include "utils.h"
 #include "move_gen.h"
+#include "memory.h"
+#include "nnue.h"
 #include "trans_table.h"
 
 using std::string;
@@ -97,6 +99,17 @@ namespace engine {
 		assert(count == 3668);
 	}
 
+	state_stack::state_stack() :
+		states(static_cast<state_info*>(std_aligned_alloc(alignof(state_info), STACK_SIZE * sizeof(state_info)))) {
+		if (!states) {
+			std::cerr << "failed to alloc state stack" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		std::memset(states, 0, STACK_SIZE * sizeof(state_info));
+	}
+
+	state_stack::~state_stack() { std_aligned_free(states); }
+
 	//init pos with fen string
 	position& position::set(const string& fen_str, state_info* si) {
 		unsigned char col, row, token;
@@ -166,6 +179,18 @@ namespace engine {
 		return *this;
 	}
 
+	void position::set_attack_table(attack_table* at) {
+		attack_tbl = at;
+		if (attack_tbl)
+			attack_tbl->init(*this);
+	}
+
+	void position::set_accumulator_stack(nnue::accumulator_stack* as) {
+		acc_stack = as;
+		if (acc_stack)
+			acc_stack->reset(*this);
+	}
+
 	void position::set_castling_rights(color c, square rfrom) {
 		square kfrom = _square<KING>(c);
 		castling_rights cr = c & (kfrom < rfrom ? KING_SIDE : QUEEN_SIDE);
@@ -183,7 +208,11 @@ namespace engine {
 	void position::set_check() const {
 		update_slider_blockers(WHITE);
 		update_slider_blockers(BLACK);
+		update_check_squares();
+	}
 
+	//squares our pieces could move to to give check, by piece type
+	void position::update_check_squares() const {
 		square ks = _square<KING>(~_side_to_move);
 
 		st->check_squares[PAWN] = pawn_attacks_bb(~_side_to_move, ks);
@@ -192,6 +221,7 @@ namespace engine {
 		st->check_squares[ROOK] = attacks_bb<ROOK>(ks, pieces());
 		st->check_squares[QUEEN] = st->check_squares[BISHOP] | st->check_squares[ROOK];
 		st->check_squares[KING] = 0;
+		st->check_info |= CHECK_SQUARES;
 	}
 	//compute hash keys of pos and other data that is incremented as moves are made
 	void position::set_state() const {
@@ -327,6 +357,7 @@ namespace engine {
 					st->pinners[~c] |= sniper_s;
 			}
 		}
+		st->check_info |= (1 << c);
 	}
 	//compute bb of all pieces that attakc a square
 	bb position::attackers_to(square s, bb occupied) const {
@@ -369,7 +400,7 @@ namespace engine {
 			assert(piece_on(cap_s) == make_piece(~us, PAWN));
 			assert(piece_on(to) == NO_PIECE);
 
-			return !(attacks_bb<ROOK>(ks, occupied) & pieces(~us, QUEEN, ROOK)) && !(attacks_bb<BISHOP>(ks, occupied) & pieces(~us, QUEEN, ROOK));
+			return !(attacks_bb<ROOK>(ks, occupied) & pieces(~us, QUEEN, ROOK)) && !(attacks_bb<BISHOP>(ks, occupied) & pieces(~us, QUEEN, BISHOP));
 		}
 
 		//only need to check if castling path is clear from enemy attacks 
@@ -396,9 +427,11 @@ namespace engine {
 		square to = m.to_sq();
 		piece p = moved_piece(m);
 
-		//use the slower but simpler function for uncommon (promotion, castling, en passant) cases
-		if (m.type_of() != NORMAL)
-			return checkers() ? move_list<EVASIONS>(*this).contains(m) : move_list<NON_EVASIONS>(*this).contains(m);
+		//use the slower but simpler function for uncommon (promotion, castling, en passant) cases, stops generating as soon as it finds the move
+		if (m.type_of() != NORMAL) {
+			auto is_m = [m](move _m) { return _m == m; };
+			return checkers() ? generate<EVASIONS>(*this, is_m) : generate<NON_EVASIONS>(*this, is_m);
+		}
 
 		assert(m.promotion_type() - KNIGHT == NO_PIECE_TYPE);
 
@@ -500,6 +533,21 @@ namespace engine {
 		assert(captured == NO_PIECE || color_of(captured) == (m.type_of() != CASTLING ? them : us));
 		assert(type_of(captured) != KING);
 
+		//what changed on the board, for the nnue accumulators
+		nnue::dirty_piece dp;
+		dp.count = 1;
+		dp.pc[0] = pc;
+		dp.from[0] = from;
+		dp.to[0] = to;
+
+		//take out the attacks that are about to change, they get put back once the board is updated
+		bb changed = 0, dirty = 0;
+		if (attack_tbl) {
+			changed = changed_squares(m, us);
+			dirty = attack_tbl->touching(*this, changed);
+			attack_tbl->remove(dirty);
+		}
+
 		if (m.type_of() == CASTLING)
 		{
 			assert(pc == make_piece(us, KING));
@@ -508,8 +556,15 @@ namespace engine {
 			square rfrom, rto;
 			do_castling<true>(us, from, to, rfrom, rto);
 
+			dp.to[0] = to;
+			dp.pc[1] = captured;
+			dp.from[1] = rfrom;
+			dp.to[1] = rto;
+			dp.count = 2;
+
 			k ^= zobrist::psq[captured][rfrom] ^ zobrist::psq[captured][rto];
 			st->non_pawn_key[us] ^= zobrist::psq[captured][rfrom] ^ zobrist::psq[captured][rto];
+			st->major_piece_key ^= zobrist::psq[captured][rfrom] ^ zobrist::psq[captured][rto];
 			captured = NO_PIECE;
 		}
 
@@ -539,12 +594,19 @@ namespace engine {
 				st->non_pawn_material[them] -= piece_value[captured];
 				st->non_pawn_key[them] ^= zobrist::psq[captured][capsq];
 
-				if (type_of(captured) <= BISHOP)
+				if (type_of(captured) >= ROOK)
+					st->major_piece_key ^= zobrist::psq[captured][capsq];
+				else
 					st->minor_piece_key ^= zobrist::psq[captured][capsq];
 			}
 
 			remove_piece(capsq);
 
+			dp.pc[1] = captured;
+			dp.from[1] = capsq;
+			dp.to[1] = SQ_NONE;
+			dp.count = 2;
+
 			k ^= zobrist::psq[captured][capsq];
 			st->material_key ^= zobrist::psq[captured][piece_count[captured]];
 
@@ -593,12 +655,21 @@ namespace engine {
 				remove_piece(to);
 				put_piece(promotion, to);
 
+				dp.to[0] = SQ_NONE;
+				dp.pc[dp.count] = promotion;
+				dp.from[dp.count] = SQ_NONE;
+				dp.to[dp.count] = to;
+				dp.count++;
+
 				k ^= zobrist::psq[pc][to] ^ zobrist::psq[promotion][to];
 				st->pawn_key ^= zobrist::psq[pc][to];
 				st->material_key ^=
 					zobrist::psq[promotion][piece_count[promotion] - 1] ^ zobrist::psq[pc][piece_count[pc]];
 
-				if (promotionType <= BISHOP)
+				st->non_pawn_key[us] ^= zobrist::psq[promotion][to];
+				if (promotionType >= ROOK)
+					st->major_piece_key ^= zobrist::psq[promotion][to];
+				else
 					st->minor_piece_key ^= zobrist::psq[promotion][to];
 
 				st->non_pawn_material[us] += piece_value[promotion];
@@ -614,10 +685,19 @@ namespace engine {
 		{
 			st->non_pawn_key[us] ^= zobrist::psq[pc][from] ^ zobrist::psq[pc][to];
 
-			if (type_of(pc) <= BISHOP)
+			//kings are part of both keys, same as in set()
+			if (type_of(pc) != BISHOP && type_of(pc) != KNIGHT)
+				st->major_piece_key ^= zobrist::psq[pc][from] ^ zobrist::psq[pc][to];
+			if (type_of(pc) != ROOK && type_of(pc) != QUEEN)
 				st->minor_piece_key ^= zobrist::psq[pc][from] ^ zobrist::psq[pc][to];
 		}
 
+		if (attack_tbl)
+			attack_tbl->add(*this, (dirty & ~changed) | (changed & pieces()));
+
+		if (acc_stack)
+			acc_stack->push(dp);
+
 		st->key = k;
 		if (tt)
 			prefetch(tt->first_entry(r_key()));
@@ -628,7 +708,7 @@ namespace engine {
 
 		_side_to_move = ~_side_to_move;
 
-		set_check();
+		st->check_info = CHECK_INFO_NONE; //filled in on demand
 
 		// calculate the repetition info. It is the ply distance from the previous
 		// occurrence of the same position, negative in the 3-fold case, or zero
@@ -666,6 +746,13 @@ namespace engine {
 		assert(empty(from) || m.type_of() == CASTLING);
 		assert(type_of(st->captured_piece) != KING);
 
+		bb changed = 0, dirty = 0;
+		if (attack_tbl) {
+			changed = changed_squares(m, us);
+			dirty = attack_tbl->touching(*this, changed);
+			attack_tbl->remove(dirty);
+		}
+
 		if (m.type_of() == PROMOTION)
 		{
 			assert(relative_rank(us, to) == RANK_8);
@@ -705,6 +792,12 @@ namespace engine {
 			}
 		}
 
+		if (attack_tbl)
+			attack_tbl->add(*this, (dirty & ~changed) | (changed & pieces()));
+
+		if (acc_stack)
+			acc_stack->pop();
+
 		st = st->prev;
 		--_game_ply;
 
@@ -731,6 +824,7 @@ namespace engine {
 		assert(!checkers());
 		assert(&new_st != st);
 
+		std::memcpy(&new_st, st, sizeof(state_info));
 		new_st.prev = st;
 		st->next = &new_st;
 		st = &new_st;
@@ -747,9 +841,12 @@ namespace engine {
 
 		st->plys_from_null = 0;
 
+		if (acc_stack)
+			acc_stack->push_null();
+
 		_side_to_move = ~_side_to_move;
 
-		set_check();
+		st->check_info = CHECK_INFO_NONE;
 
 		st->repititon = 0;
 
@@ -760,6 +857,9 @@ namespace engine {
 
 		assert(!checkers());
 
+		if (acc_stack)
+			acc_stack->pop();
+
 		st = st->prev;
 		_side_to_move = ~_side_to_move;
 	}
@@ -855,7 +955,7 @@ namespace engine {
 	}
 
 	bool position::is_draw(int ply) const {//only checks for 50 move rule and repetition, not stalemate
-		if (st->move_rule_50 > 99 && (!checkers() || move_list<LEGAL>(*this).size()))
+		if (st->move_rule_50 > 99 && (!checkers() || has_legal_moves(*this)))
 			return true;
 
 		return is_repetition(ply);
@@ -949,6 +1049,12 @@ namespace engine {
 		if ((_side_to_move != WHITE && _side_to_move != BLACK) || piece_on(_square<KING>(WHITE)) != W_KING || piece_on(_square<KING>(BLACK)) != B_KING || (ep_square() != SQ_NONE && relative_rank(_side_to_move, ep_square()) != RANK_6)){
 			assert(0 && "pos_is_ok: default");
 		}
+
+		int mg_sum, eg_sum;
+		psqt::compute(*this, mg_sum, eg_sum);
+		if (mg_sum != _psq_mg || eg_sum != _psq_eg)
+			assert(0 && "pos_is_ok: psq");
+
 		return true;
 	}
 }
\ No newline at end of file
@@ -2,16 +2,35 @@
 #define POSITION_H_INC
 
 #include <cassert>
+#include <cstddef>
 #include <deque>
 
+#include "attack_table.h"
 #include "bitboard.h"
+#include "psqt.h"
 #include "types.h"
 
 namespace engine {
 
 	class transposition_table;
 
-	struct state_info {
+	namespace nnue {
+		class accumulator_stack;
+	}
+
+	//which parts of the check info in state_info are up to date, they get filled in the first time someone asks for them
+	enum check_info_flags : uint8_t {
+		CHECK_INFO_NONE = 0,
+		BLOCKERS_WHITE = 1 << WHITE, //blockers_for_king[WHITE] and pinners[BLACK]
+		BLOCKERS_BLACK = 1 << BLACK, //blockers_for_king[BLACK] and pinners[WHITE]
+		CHECK_SQUARES = 1 << 2,
+		CHECK_INFO_ALL = BLOCKERS_WHITE | BLOCKERS_BLACK | CHECK_SQUARES
+	};
+
+	//laid out by how often do_move touches things, every state starts on a cache line
+	//the first two lines are hot: the copied part (read from the parent by do_move) and the part do_move recomputes
+	//the lazy check info is cold and gets its own lines so nodes that never need it never touch them
+	struct alignas(64) state_info {
 		//copied
 		uint64_t material_key;
 		uint64_t pawn_key;
@@ -29,11 +48,37 @@ namespace engine {
 		bb checkers_bb;
 		state_info* prev;
 		state_info* next;
-		bb blockers_for_king[COLOR_NB];
-		bb pinners[COLOR_NB];
-		bb check_squares[PIECE_TYPE_NB];
 		piece captured_piece;
 		int repititon; 
+		uint8_t check_info; //check_info_flags, the lazy fields below are only valid if their bit is set
+
+		//lazy, cold
+		alignas(64) bb blockers_for_king[COLOR_NB];
+		bb pinners[COLOR_NB];
+		bb check_squares[PIECE_TYPE_NB];
+	};
+
+	static_assert(offsetof(state_info, check_info) < 128, "hot part of state_info has to fit in two cache lines");
+	static_assert(offsetof(state_info, blockers_for_king) == 128, "cold part of state_info should start on its own cache line");
+
+	//one search thread's states in a single cache line aligned block, index by ply
+	//allocated once up front so do_move always writes into the same contiguous, already warm memory instead of a new stack frame
+	class state_stack {
+	public:
+		static constexpr int STACK_SIZE = MAX_PLY + 10; //a bit of slack for qsearch and the root
+
+		state_stack();
+		~state_stack();
+		state_stack(const state_stack&) = delete;
+		state_stack& operator=(const state_stack&) = delete;
+
+		state_info& operator[](int ply) {
+			assert(ply >= 0 && ply < STACK_SIZE);
+			return states[ply];
+		}
+
+	private:
+		state_info* states;
 	};
 
 	class position {
@@ -84,9 +129,16 @@ namespace engine {
 		bb attackers_to(square s, bb occupied) const;
 		bool attackers_to_exist(square s, bb occupied, color c) const;
 		void update_slider_blockers(color c) const;
+		void update_check_squares() const;
 		template<piece_type pt>
 		bb attacks_by(color c) const;
 
+		//optional incremental attack table, set() detaches it so attach after setting the position
+		void set_attack_table(attack_table* at);
+		const attack_table* attacks() const;
+		void set_accumulator_stack(nnue::accumulator_stack* as); //do_move/undo_move keep it in sync while attached
+		nnue::accumulator_stack* accumulators() const; //not const, evaluate builds the accumulators lazily
+
 		//properties
 		bool legal(move m) const;
 		bool psuedo_legal(const move m) const; //can mark move as const because its not modified in the function
@@ -124,6 +176,8 @@ namespace engine {
 		int move_rule_50_count() const;
 		int non_pawn_material(color c) const;
 		int non_pawn_material() const;
+		int psq_mg() const; //piece square sums, white's point of view
+		int psq_eg() const;
 
 		//debug
 		bool pos_isnt_bad() const;
@@ -145,6 +199,7 @@ namespace engine {
 		void do_castling(color c, square from, square& to, square& rfrom, square& rto); //pass in by refernce to move them
 		template<bool post_move>
 		uint64_t adjust_key50(uint64_t k) const;
+		bb changed_squares(move m, color us) const;
 
 		//data 
 		piece board[SQUARE_NB];
@@ -155,8 +210,11 @@ namespace engine {
 		square _castling_rook_square[CASTLING_RIGHT_NB];
 		bb castling_path[CASTLING_RIGHT_NB];
 		state_info* st;
+		attack_table* attack_tbl;
+		nnue::accumulator_stack* acc_stack;
 		int _game_ply;
 		color _side_to_move;
+		int _psq_mg, _psq_eg; //not in state_info, undo_move puts the pieces back through the same helpers so they unwind themselves
 	}; 
 
 	std::ostream& operator<<(std::ostream& os, const position& pos);
@@ -202,7 +260,22 @@ namespace engine {
 		assert(cr == WHITE_OO || cr == WHITE_OOO || cr == BLACK_OO || cr == BLACK_OOO);
 		return _castling_rook_square[cr];
 	}
-	inline bb position::attackers_to(square s) const { return attackers_to(s, pieces()); }
+	inline bb position::attackers_to(square s) const { return attack_tbl ? attack_tbl->attackers(s) : attackers_to(s, pieces()); }
+	inline const attack_table* position::attacks() const { return attack_tbl; }
+	inline nnue::accumulator_stack* position::accumulators() const { return acc_stack; }
+	//squares whose occupancy m changes, the attack table needs them to know which pieces to redo
+	inline bb position::changed_squares(move m, color us) const {
+		square from = m.from_sq();
+		square to = m.to_sq();
+
+		if (m.type_of() == CASTLING) //to is the rook square
+			return from | to | relative_square(us, to > from ? SQ_G1 : SQ_C1) | relative_square(us, to > from ? SQ_F1 : SQ_D1);
+
+		if (m.type_of() == EN_PASSANT)
+			return from | to | (to - pawn_push(us));
+
+		return from | to;
+	}
 	template<piece_type pt>
 	inline bb position::attacks_by(color c) const {
 		if constexpr (pt == PAWN)
@@ -216,9 +289,22 @@ namespace engine {
 		}
 	}
 	inline bb position::checkers() const { return st->checkers_bb; }
-	inline bb position::blockers_for_king(color c) const { return st->blockers_for_king[c]; }
-	inline bb position::pinners(color c) const { return st->pinners[c]; }
-	inline bb position::check_squares(piece_type pt) const { return st->check_squares[pt]; }
+	//check info is lazy, do_move only clears the flags so nodes that get cut off before generating moves never pay for the slider scans
+	inline bb position::blockers_for_king(color c) const {
+		if (!(st->check_info & (1 << c)))
+			update_slider_blockers(c);
+		return st->blockers_for_king[c];
+	}
+	inline bb position::pinners(color c) const {
+		if (!(st->check_info & (1 << ~c)))
+			update_slider_blockers(~c);
+		return st->pinners[c];
+	}
+	inline bb position::check_squares(piece_type pt) const {
+		if (!(st->check_info & CHECK_SQUARES))
+			update_check_squares();
+		return st->check_squares[pt];
+	}
 
 	inline uint64_t position::r_key() const { return adjust_key50<false>(st->key); }
 
@@ -236,6 +322,8 @@ namespace engine {
 	inline int position::non_pawn_material() const {
 		return non_pawn_material(WHITE) + non_pawn_material(BLACK);
 	}
+	inline int position::psq_mg() const { return _psq_mg; }
+	inline int position::psq_eg() const { return _psq_eg; }
 	inline int position::game_ply() const { return _game_ply; }
 	inline int position::move_rule_50_count() const { return st->move_rule_50; }
 	inline bool position::capture(move m) const {
@@ -254,6 +342,8 @@ namespace engine {
 		color_bb[color_of(p)] |= s;
 		piece_count[p]++;
 		piece_count[make_piece(color_of(p), ALL_PIECES)]++;
+		_psq_mg += psqt::mg[p][s];
+		_psq_eg += psqt::eg[p][s];
 	}
 	inline void position::remove_piece(square s) {
 
@@ -264,6 +354,8 @@ namespace engine {
 		board[s] = NO_PIECE;
 		piece_count[p]--;
 		piece_count[make_piece(color_of(p), ALL_PIECES)]--;
+		_psq_mg -= psqt::mg[p][s];
+		_psq_eg -= psqt::eg[p][s];
 	}
 	inline void position::move_piece(square from, square to) {
 
@@ -274,6 +366,8 @@ namespace engine {
 		color_bb[color_of(p)] ^= fromTo;
 		board[from] = NO_PIECE;
 		board[to] = p;
+		_psq_mg += psqt::mg[p][to] - psqt::mg[p][from];
+		_psq_eg += psqt::eg[p][to] - psqt::eg[p][from];
 	}
 	inline void position::do_move(move m, state_info& new_st, const transposition_table* tt = nullptr) {
 		do_move(m, new_st, gives_check(m), tt);
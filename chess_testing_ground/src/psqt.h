@@ -0,0 +1,22 @@
+#ifndef PSQT_H_INC
+#define PSQT_H_INC
+
+#include "types.h"
+
+namespace engine {
+	class position;
+
+	//piece square bonuses for the hand written eval, white's point of view, black pieces hold the mirrored negated value
+	//position keeps the sums up to date in put_piece/remove_piece/move_piece so the eval just reads them
+	namespace psqt {
+		extern int mg[PIECE_NB][SQUARE_NB];
+		extern int eg[PIECE_NB][SQUARE_NB];
+
+		void init();
+
+		//sums over every piece on the board, what the incremental sums have to agree with
+		void compute(const position& pos, int& mg_sum, int& eg_sum);
+	}
+}
+
+#endif
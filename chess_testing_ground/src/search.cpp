@@ -0,0 +1,1024 @@
+#include "search.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "book.h"
+#include "evaluate.h"
+#include "move_gen.h"
+#include "movepick.h"
+#include "uci.h"
+
+namespace engine {
+	search::pruning_options search::pruning;
+
+	namespace {
+		//main search pruning margins, in the same units as the eval (pawn_value is 208)
+		constexpr int RFP_MARGIN = 120; //per ply of depth, static eval this far over beta is assumed to hold
+		constexpr int RFP_MAX_DEPTH = 9;
+		constexpr int FUTILITY_BASE = 150; //quiet move can't gain more than this plus FUTILITY_MARGIN per ply
+		constexpr int FUTILITY_MARGIN = 120;
+		constexpr int FUTILITY_MAX_DEPTH = 9;
+		constexpr int SEE_QUIET_MARGIN = 25; //times lmr depth squared, how much material a quiet may hang
+		constexpr int NMP_VERIFY_DEPTH = 14; //below this a null move cutoff is trusted as is
+
+		//log shaped, reduction(depth, move_count) is about log(depth) * log(move_count) / 2.4
+		int reductions[MAX_MOVES];
+
+		int reduction(bool improving, int depth, int move_count) {
+			const int r = reductions[std::min(depth, MAX_MOVES - 1)] * reductions[std::min(move_count, MAX_MOVES - 1)];
+			return (r + 512) / 1024 + (!improving && r > 1024);
+		}
+
+		//how many quiets deep into the list before the rest are assumed useless
+		int late_move_count(bool improving, int depth) { return (3 + depth * depth) / (2 - improving); }
+
+		//qsearch pruning margins
+		//delta: stand pat plus the captured piece plus this still can't reach alpha, so the capture can't either
+		//see: a capture losing more than this in the exchange isn't worth looking at on the horizon
+		constexpr int DELTA_MARGIN = 351;
+		constexpr int QS_SEE_MARGIN = 78;
+
+		//mate scores in the tt are relative to the node they were found at, the search works with them relative to the root
+		int value_to_tt(int v, int ply) {
+			return v >= VALUE_TB_WIN_IN_MAX_PLY ? v + ply : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v - ply : v;
+		}
+
+		int value_from_tt(int v, int ply) {
+			if (v == VALUE_NONE)
+				return VALUE_NONE;
+
+			return v >= VALUE_TB_WIN_IN_MAX_PLY ? v - ply : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v + ply : v;
+		}
+
+		int stat_bonus(int depth) { return std::min(170 * depth - 90, 1500); }
+
+		//what m takes, en passant lands on an empty square
+		piece_type captured_type(const position& pos, move m) {
+			return m.type_of() == EN_PASSANT ? PAWN : type_of(pos.piece_on(m.to_sq()));
+		}
+
+		//correction entries are summed with these weights then divided by CORRECTION_SCALE,
+		//a fully saturated set of tables moves the eval by about a pawn
+		constexpr int PAWN_CORRECTION_WEIGHT = 2;
+		constexpr int MINOR_CORRECTION_WEIGHT = 1;
+		constexpr int MAJOR_CORRECTION_WEIGHT = 1;
+		constexpr int NON_PAWN_CORRECTION_WEIGHT = 1;
+		constexpr int CORRECTION_SCALE = 32;
+
+		void update_pv(move* pv, move m, const move* child_pv) {
+			for (*pv++ = m; child_pv && *child_pv != move::none();)
+				*pv++ = *child_pv++;
+			*pv = move::none();
+		}
+
+		std::string score_to_uci(int v) {
+			std::stringstream ss;
+
+			if (std::abs(v) >= VALUE_MATE_IN_MAX_PLY)
+				ss << "mate " << (v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v) / 2;
+			else
+				ss << "cp " << v * 100 / pawn_value;
+
+			return ss.str();
+		}
+	}
+
+	void search::init() {
+		for (int i = 1; i < MAX_MOVES; i++)
+			reductions[i] = int(20.8 * std::log(i));
+	}
+
+	search::worker::worker(transposition_table& _tt) : stop(false), ponder(false), nodes(0), qnodes(0), tb_hits(0), multi_pv(1), stop_on_ponderhit(false), tt(_tt),
+		cont_history(std::make_unique<continuation_history>()),
+		root_depth(0), sel_depth(0), completed_depth(0), pv_idx(0), nmp_min_ply(0),
+		best_move_changes(0), previous_time_reduction(1.0), best_previous_score(VALUE_INFINITE), last_best_move_depth(0),
+		iter_values{}, last_best_move(move::none()), delta_pruned(0), see_pruned(0),
+		null_cutoffs(0), rfp_cutoffs(0), futility_pruned(0), lmp_skips(0), see_quiet_pruned(0), lmr_researches(0),
+		cutoffs(0), first_move_cutoffs(0) {
+		clear();
+	}
+
+	void search::worker::clear() {
+		main_history.clear();
+		capture_hist.clear();
+		cont_history->clear();
+		counter_moves.clear();
+		pawn_correction.clear();
+		minor_correction.clear();
+		major_correction.clear();
+		for (auto& h : non_pawn_correction)
+			h.clear();
+		eval_tables.evals.clear(); //the eval might have changed underneath it (new net, Use NNUE)
+		mate_solver.clear();
+		mcts_tree.clear();
+
+		previous_time_reduction = 1.0;
+		best_previous_score = VALUE_INFINITE;
+	}
+
+	void search::worker::start_searching(const std::string& fen, const state_info& root_state, const limits_type& lim) {
+		limits = lim;
+
+		//the copied state keeps prev pointing into the game history so repetitions of game positions are still seen
+		root_pos.set(fen, &states[0]);
+		states[0] = root_state;
+		root_pos.set_accumulator_stack(&accumulators);
+		timer.init(limits, root_pos.side_to_move(), root_pos.game_ply());
+
+		nodes.store(0, std::memory_order_relaxed);
+		qnodes = tb_hits = delta_pruned = see_pruned = 0;
+		null_cutoffs = rfp_cutoffs = futility_pruned = lmp_skips = see_quiet_pruned = lmr_researches = 0;
+		cutoffs = first_move_cutoffs = 0;
+		nmp_min_ply = 0;
+		eval_tables.cache_probes = eval_tables.cache_hits = 0;
+		root_depth = sel_depth = completed_depth = 0;
+		stop_on_ponderhit = false;
+		std::fill(std::begin(asp_stats), std::end(asp_stats), aspiration_stats{});
+
+		root_moves.clear();
+		for (const auto& m : move_list<LEGAL>(root_pos))
+			if (limits.search_moves.empty()
+				|| std::count(limits.search_moves.begin(), limits.search_moves.end(), uci_engine::n_move(m)))
+				root_moves.emplace_back(m);
+
+		tt.new_search();
+
+		//a book move goes out without searching, except under go infinite where the gui wants to see the analysis
+		bool book_hit = false;
+		if (!root_moves.empty() && !limits.infinite && !limits.mate) {
+			const move bm = book::probe(root_pos);
+			const auto it = std::find(root_moves.begin(), root_moves.end(), bm);
+
+			if (bm && it != root_moves.end()) {
+				std::rotate(root_moves.begin(), it, it + 1);
+				book_hit = true;
+				sync_cout << "info string book move " << uci_engine::n_move(bm) << sync_endl;
+			}
+		}
+
+		//in the tablebases only the moves that keep the best result are left, the search just picks between them
+		tb_config = tablebases::config{};
+		if (!root_moves.empty() && !book_hit && tablebases::max_cardinality) {
+			tb_config = tablebases::rank_root_moves(root_pos, root_moves);
+			if (tb_config.root_in_tb)
+				tb_hits = root_moves.size();
+		}
+
+		if (root_moves.empty()) {
+			root_moves.emplace_back(move::none());
+			sync_cout << "info depth 0 score " << score_to_uci(root_pos.checkers() ? -VALUE_MATE : VALUE_DRAW) << sync_endl;
+		}
+		else if (limits.mate)
+			mate_search();
+		else if (!book_hit) {
+			if (mcts::options.enabled)
+				mcts_search(fen, root_state);
+			else
+				iterative_deepening();
+		}
+
+		//go infinite and go ponder have to wait for stop or ponderhit before they get to say bestmove, even when the search ran out of depth
+		while ((limits.infinite || ponder) && !stop)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		const root_move& best = root_moves[0];
+		best_previous_score = book_hit ? VALUE_INFINITE : best.score; //a book move has no score for the next search to start from
+
+		const uint64_t searched = nodes.load(std::memory_order_relaxed);
+
+		//effective branching factor, the depth'th root of the nodes it took to finish that depth
+		const double ebf = completed_depth ? std::pow(double(searched), 1.0 / completed_depth) : 0.0;
+
+		std::stringstream ss;
+		ss << "info string qnodes " << qnodes << " (" << (searched ? qnodes * 100 / searched : 0) << "% of nodes)"
+			<< " delta_pruned " << delta_pruned << " see_pruned " << see_pruned
+			<< " evalcache " << eval_tables.cache_hits << "/" << eval_tables.cache_probes
+			<< " (" << (eval_tables.cache_probes ? eval_tables.cache_hits * 100 / eval_tables.cache_probes : 0) << "% hits)\n";
+		ss << "info string null_cutoffs " << null_cutoffs << " rfp_cutoffs " << rfp_cutoffs
+			<< " futility_pruned " << futility_pruned << " lmp_skips " << lmp_skips << " see_quiet_pruned " << see_quiet_pruned
+			<< " lmr_researches " << lmr_researches << " ebf " << std::fixed << std::setprecision(2) << ebf << "\n";
+		ss << "info string cutoffs " << cutoffs << " first_move_cutoffs " << first_move_cutoffs
+			<< " (" << std::setprecision(1) << (cutoffs ? first_move_cutoffs * 100.0 / cutoffs : 0.0) << "%)\n";
+
+		int fail_highs = 0, fail_lows = 0;
+		uint64_t research_nodes = 0;
+		for (const auto& as : asp_stats)
+			fail_highs += as.fail_highs, fail_lows += as.fail_lows, research_nodes += as.research_nodes;
+
+		ss << "info string aspiration fail_highs " << fail_highs << " fail_lows " << fail_lows << " research_nodes " << research_nodes
+			<< " (" << (searched ? research_nodes * 100.0 / searched : 0.0) << "% of nodes)\n";
+		for (int d = 1; d <= root_depth && d < MAX_PLY; ++d)
+			if (asp_stats[d].fail_highs || asp_stats[d].fail_lows)
+				ss << "info string aspiration depth " << d << " fail_highs " << asp_stats[d].fail_highs
+					<< " fail_lows " << asp_stats[d].fail_lows << " research_nodes " << asp_stats[d].research_nodes << "\n";
+		ss << "bestmove " << uci_engine::n_move(best.pv[0]);
+		if (best.pv.size() > 1)
+			ss << " ponder " << uci_engine::n_move(best.pv[1]);
+
+		sync_cout << ss.str() << sync_endl;
+	}
+
+	void search::worker::iterative_deepening() {
+		//a few spare entries below the root so ss - n never falls off the front
+		stack stack_arr[MAX_PLY + 10] = {};
+		stack* ss = stack_arr + 4;
+		move pv[MAX_PLY + 1];
+
+		for (int i = 0; i <= MAX_PLY + 2; i++)
+			(ss + i)->ply = i;
+		for (int i = 1; i <= 4; i++) {
+			(ss - i)->static_eval = VALUE_NONE;
+			(ss - i)->continuation_history = cont_history->sentinel();
+		}
+		ss->pv = pv;
+
+		best_move_changes = 0;
+		last_best_move = move::none();
+		last_best_move_depth = 0;
+		for (int& v : iter_values)
+			v = best_previous_score != VALUE_INFINITE ? best_previous_score : VALUE_ZERO;
+
+		const size_t lines = std::min(multi_pv, root_moves.size());
+
+		for (root_depth = 1; root_depth < MAX_PLY && !stop && !(limits.depth && root_depth > limits.depth); ++root_depth) {
+			for (auto& rm : root_moves)
+				rm.previous_score = rm.score;
+
+			//older changes of mind count less
+			best_move_changes /= 2;
+
+			//one root search per line, each leaves out the moves already picked for the lines above it
+			//they all share the tt, so the later lines mostly walk trees the first one already stored
+			for (pv_idx = 0; pv_idx < lines && !stop; ++pv_idx) {
+				//start with a narrow window around this line's recent scores and widen it each time the score lands outside
+				//a fail low also pulls beta down, the true score is somewhere below the old window
+				//our scores swing a lot between iterations, so the window starts wider than the usual few centipawns
+				const int previous = root_moves[pv_idx].average_score;
+				int delta = 20 + previous * previous / 14847;
+				int alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
+
+				if (pruning.aspiration && root_depth >= 4 && std::abs(previous) < VALUE_TB_WIN_IN_MAX_PLY) {
+					alpha = std::max(previous - delta, -VALUE_INFINITE);
+					beta = std::min(previous + delta, VALUE_INFINITE);
+				}
+
+				while (true) {
+					const uint64_t nodes_before = nodes.load(std::memory_order_relaxed);
+
+					sel_depth = 0;
+					const int value = search<ROOT>(root_pos, ss, alpha, beta, root_depth);
+
+					//moves that failed low this iteration sit at -VALUE_INFINITE, stable sort keeps last iteration's order among them
+					std::stable_sort(root_moves.begin() + pv_idx, root_moves.end());
+
+					if (stop)
+						break;
+
+					if (value <= alpha) {
+						beta = (alpha + beta) / 2;
+						alpha = std::max(value - delta, -VALUE_INFINITE);
+						++asp_stats[root_depth].fail_lows;
+					}
+					else if (value >= beta) {
+						beta = std::min(value + delta, VALUE_INFINITE);
+						++asp_stats[root_depth].fail_highs;
+					}
+					else
+						break;
+
+					asp_stats[root_depth].research_nodes += nodes.load(std::memory_order_relaxed) - nodes_before;
+					delta += delta / 3;
+				}
+
+				if (stop)
+					break;
+
+				//a later line can come back better than an earlier one, keep the finished lines in order
+				std::stable_sort(root_moves.begin(), root_moves.begin() + pv_idx + 1);
+			}
+
+			if (stop)
+				break;
+
+			completed_depth = root_depth;
+			print_info(root_depth);
+
+			if (root_moves[0].pv[0] != last_best_move) {
+				last_best_move = root_moves[0].pv[0];
+				last_best_move_depth = root_depth;
+			}
+
+			if (limits.use_time_management() && time_to_stop()) {
+				//the clock isn't running for us yet while pondering, stop as soon as it is
+				if (ponder)
+					stop_on_ponderhit = true;
+				else
+					stop = true;
+			}
+
+			iter_values[root_depth & 3] = root_moves[0].score;
+		}
+	}
+
+	//after each iteration, is another one worth starting
+	//the optimum gets stretched when the score is dropping or the best move keeps changing,
+	//and shrunk when the same move has been best for a while or is soaking up nearly all the nodes
+	bool search::worker::time_to_stop() {
+		const int best = root_moves[0].score;
+		const int previous = best_previous_score != VALUE_INFINITE ? best_previous_score : best;
+
+		const double falling_eval = std::clamp((66 + 14.0 * (previous - best) + 6.0 * (iter_values[root_depth & 3] - best)) / 616.6, 0.51, 1.51);
+		const double time_reduction = last_best_move_depth + 8 < completed_depth ? 1.56 : 0.69;
+		const double reduction = (1.4 + previous_time_reduction) / (2.03 * time_reduction);
+		const double instability = 1 + 1.79 * best_move_changes;
+		previous_time_reduction = time_reduction;
+
+		double total = timer.optimum() * falling_eval * reduction * instability;
+
+		//nothing to think about
+		if (root_moves.size() == 1)
+			total = std::min(500.0, total);
+
+		const time_point elapsed = timer.elapsed();
+		const uint64_t effort = root_moves[0].effort * 100 / std::max<uint64_t>(1, nodes.load(std::memory_order_relaxed));
+
+		//one move is taking all the nodes, the rest are getting refuted quickly, no need to use the full budget
+		if (completed_depth >= 10 && effort >= 97 && elapsed > total * 0.739)
+			return true;
+
+		return elapsed > total;
+	}
+
+	template<search::worker::node_type nt>
+	int search::worker::search(position& pos, stack* ss, int alpha, int beta, int depth) {
+		constexpr bool pv_node = nt != NON_PV;
+		constexpr bool root_node = nt == ROOT;
+
+		if (depth <= 0)
+			return qsearch<pv_node ? PV : NON_PV>(pos, ss, alpha, beta);
+
+		assert(-VALUE_INFINITE <= alpha && alpha < beta && beta <= VALUE_INFINITE);
+		assert(pv_node || (alpha == beta - 1));
+
+		move pv[MAX_PLY + 1];
+		move quiets_searched[64], captures_searched[32];
+		state_info& st = states[ss->ply + 1];
+		int quiet_count = 0, capture_count = 0, move_count = 0;
+		int best_value = -VALUE_INFINITE;
+		move best_move = move::none();
+
+		ss->in_check = pos.checkers();
+		ss->move_count = 0;
+		nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		check_time();
+
+		if (pv_node && sel_depth < ss->ply + 1)
+			sel_depth = ss->ply + 1;
+
+		if (!root_node) {
+			if (stop.load(std::memory_order_relaxed) || pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
+				return (ss->ply >= MAX_PLY && !ss->in_check) ? eval::evaluate(pos, eval_tables) : VALUE_DRAW;
+
+			//mate distance pruning, a shorter mate was already found somewhere above
+			alpha = std::max(mated_in(ss->ply), alpha);
+			beta = std::min(mate_in(ss->ply + 1), beta);
+			if (alpha >= beta)
+				return alpha;
+		}
+
+		(ss + 2)->killers[0] = (ss + 2)->killers[1] = move::none();
+
+		const uint64_t key = pos.r_key();
+		auto [tt_hit, tt_data, writer] = tt.probe(key);
+		const int tt_value = tt_hit ? value_from_tt(tt_data.value, ss->ply) : VALUE_NONE;
+		const move tt_move = root_node ? root_moves[pv_idx].pv[0] : tt_hit ? tt_data._move : move::none();
+
+		if (!pv_node && tt_hit && tt_data.depth >= depth && tt_value != VALUE_NONE
+			&& (tt_data._bound & (tt_value >= beta ? BOUND_LOWER : BOUND_UPPER)))
+			return tt_value;
+
+		//tablebase probe, the smallest tables at any depth and the biggest ones only when there's enough depth left
+		//right after a capture or pawn move, anything else and the 50 move counter would make the wdl wrong
+		int max_value = VALUE_INFINITE;
+
+		if (!root_node && tb_config.cardinality) {
+			const int piece_count = pop_count(pos.pieces());
+
+			if (piece_count <= tb_config.cardinality
+				&& (piece_count < tb_config.cardinality || depth >= tb_config.probe_depth)
+				&& pos.move_rule_50_count() == 0 && !pos.can_castle(ANY_CASTLING)) {
+				tablebases::probe_state result;
+				const tablebases::wdl_score wdl = tablebases::probe_wdl(pos, &result);
+
+				if (result != tablebases::FAIL) {
+					++tb_hits;
+
+					//cursed wins and blessed losses are draws with the 50 move rule, just a hair off zero so the search prefers them
+					const int draw_score = tb_config.rule50 ? 1 : 0;
+					const int value = wdl < -draw_score ? -VALUE_TB + ss->ply
+						: wdl > draw_score ? VALUE_TB - ss->ply
+						: VALUE_DRAW + 2 * wdl * draw_score;
+
+					const bound b = wdl < -draw_score ? BOUND_UPPER : wdl > draw_score ? BOUND_LOWER : BOUND_EXACT;
+
+					if (b == BOUND_EXACT || (b == BOUND_LOWER ? value >= beta : value <= alpha)) {
+						writer.write(key, value_to_tt(value, ss->ply), pv_node, b, std::min(MAX_PLY - 1, depth + 6),
+							move::none(), VALUE_NONE, tt.generation());
+						return value;
+					}
+
+					//a win that didn't cut still needs the pv, the search can only do better than it (or worse than a loss)
+					if (pv_node) {
+						if (b == BOUND_LOWER)
+							best_value = value, alpha = std::max(alpha, best_value);
+						else
+							max_value = value;
+					}
+				}
+			}
+		}
+
+		//the tt keeps the raw eval, the correction keeps changing as the search learns so it's applied after the probe
+		int raw_eval = VALUE_NONE;
+		if (ss->in_check)
+			ss->static_eval = VALUE_NONE;
+		else if (tt_hit && tt_data.eval != VALUE_NONE) {
+			raw_eval = tt_data.eval;
+			ss->static_eval = correct_eval(pos, raw_eval);
+		}
+		else {
+			raw_eval = eval::evaluate(pos, eval_tables);
+			ss->static_eval = correct_eval(pos, raw_eval);
+
+			//put the eval in the tt straight away, if this node gets cut short or stopped it still saves the next visit an eval
+			writer.write(key, VALUE_NONE, pv_node, BOUND_NONE, DEPTH_UNSEARCHED, move::none(), raw_eval, tt.generation());
+		}
+
+		const color us = pos.side_to_move();
+
+		//eval went up since our last move, the margins below can be less trusting when it hasn't
+		const bool improving = !ss->in_check && (ss - 2)->static_eval != VALUE_NONE && ss->static_eval > (ss - 2)->static_eval;
+
+		if (!pv_node && !ss->in_check) {
+			//reverse futility, so far above beta that no reply is going to bring it back
+			if (pruning.reverse_futility && depth < RFP_MAX_DEPTH
+				&& ss->static_eval - RFP_MARGIN * (depth - improving) >= beta
+				&& ss->static_eval < VALUE_TB_WIN_IN_MAX_PLY && beta > VALUE_TB_LOSS_IN_MAX_PLY) {
+				++rfp_cutoffs;
+				return ss->static_eval;
+			}
+
+			//null move, if passing still fails high a real move will too, except in zugzwang so not with only pawns left
+			if (pruning.null_move && (ss - 1)->current_move != move::null() && ss->static_eval >= beta
+				&& pos.non_pawn_material(us) && ss->ply >= nmp_min_ply && beta > VALUE_TB_LOSS_IN_MAX_PLY) {
+				const int r = 3 + depth / 3 + std::min((ss->static_eval - beta) / 200, 3);
+
+				ss->current_move = move::null();
+				ss->continuation_history = cont_history->sentinel();
+				pos.do_null_move(st, tt);
+				const int null_value = -search<NON_PV>(pos, ss + 1, -beta, -beta + 1, depth - r);
+				pos.undo_null_move();
+
+				if (null_value >= beta && null_value < VALUE_TB_WIN_IN_MAX_PLY) {
+					if (nmp_min_ply || depth < NMP_VERIFY_DEPTH) {
+						++null_cutoffs;
+						return null_value;
+					}
+
+					//deep cutoffs get checked by a reduced search with null moves off for us for a while, catches zugzwangs
+					nmp_min_ply = ss->ply + 3 * (depth - r) / 4;
+					const int v = search<NON_PV>(pos, ss, beta - 1, beta, depth - r);
+					nmp_min_ply = 0;
+
+					if (v >= beta) {
+						++null_cutoffs;
+						return null_value;
+					}
+				}
+			}
+		}
+
+		const square prev_sq = (ss - 1)->current_move.is_ok() ? (ss - 1)->current_move.to_sq() : SQ_NONE;
+		const move counter = prev_sq != SQ_NONE ? counter_moves.get(pos.piece_on(prev_sq), prev_sq) : move::none();
+
+		const piece_to_history* cont_hist[] = { (ss - 1)->continuation_history, (ss - 2)->continuation_history };
+		move_picker mp(pos, tt_move, depth, &main_history, &capture_hist, cont_hist, ss->killers, counter);
+		move m;
+
+		while ((m = mp.next_move()) != move::none()) {
+			if (root_node && !std::count(root_moves.begin() + pv_idx, root_moves.end(), m))
+				continue;
+
+			if (!pos.legal(m))
+				continue;
+
+			ss->move_count = ++move_count;
+			ss->current_move = m;
+
+			if (pv_node)
+				(ss + 1)->pv = nullptr;
+
+			const bool capture = pos.capture_stage(m);
+			const bool gives_check = pos.gives_check(m);
+			int value = -VALUE_INFINITE;
+
+			const int r = reduction(improving, depth, move_count);
+
+			//shallow pruning, only once something has been found that isn't getting mated and there are pieces to defend with
+			if (!root_node && pos.non_pawn_material(us) && best_value > VALUE_TB_LOSS_IN_MAX_PLY) {
+				if (pruning.late_move && move_count >= late_move_count(improving, depth) && !mp.quiets_skipped()) {
+					mp.skip_quiet_moves();
+					++lmp_skips;
+				}
+
+				if (!capture && !gives_check) {
+					const int lmr_depth = std::max(depth - 1 - r, 0);
+
+					//futility, even a big positional gain doesn't get this quiet to alpha
+					if (pruning.futility && !ss->in_check && lmr_depth < FUTILITY_MAX_DEPTH
+						&& ss->static_eval + FUTILITY_BASE + FUTILITY_MARGIN * lmr_depth <= alpha) {
+						++futility_pruned;
+						continue;
+					}
+
+					//quiet that just hangs material
+					if (pruning.see_quiet && !pos.see_ge(m, -SEE_QUIET_MARGIN * lmr_depth * lmr_depth)) {
+						++see_quiet_pruned;
+						continue;
+					}
+				}
+			}
+
+			const uint64_t nodes_before = nodes.load(std::memory_order_relaxed);
+			const piece moved = pos.moved_piece(m); //the from square is empty once the move is made
+			ss->continuation_history = cont_history->at(moved, m.to_sq());
+			pos.do_move(m, st, gives_check, &tt);
+
+			//late move reductions, quiets late in the ordering get a shallower null window search first
+			//and only the ones that beat alpha anyway are searched again at full depth
+			if (pruning.lmr && depth >= 2 && move_count > 1 + root_node && !capture && !ss->in_check) {
+				const int stat_score = 2 * main_history.get(us, m) + cont_hist[0]->get(moved, m.to_sq())
+					+ cont_hist[1]->get(moved, m.to_sq());
+				int lmr_r = r - pv_node - gives_check - (m == ss->killers[0] || m == ss->killers[1] || m == counter)
+					- stat_score / 10000;
+				const int d = std::clamp(depth - 1 - lmr_r, 1, depth - 1);
+
+				value = -search<NON_PV>(pos, ss + 1, -(alpha + 1), -alpha, d);
+
+				if (value > alpha && d < depth - 1) {
+					++lmr_researches;
+					value = -search<NON_PV>(pos, ss + 1, -(alpha + 1), -alpha, depth - 1);
+				}
+			}
+			//principal variation search, everything after the first move gets a null window first
+			else if (!pv_node || move_count > 1)
+				value = -search<NON_PV>(pos, ss + 1, -(alpha + 1), -alpha, depth - 1);
+
+			if (pv_node && (move_count == 1 || (value > alpha && (root_node || value < beta)))) {
+				(ss + 1)->pv = pv;
+				(ss + 1)->pv[0] = move::none();
+				value = -search<PV>(pos, ss + 1, -beta, -alpha, depth - 1);
+			}
+
+			pos.undo_move(m);
+
+			assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
+
+			if (stop.load(std::memory_order_relaxed))
+				return VALUE_ZERO;
+
+			if (root_node) {
+				root_move& rm = *std::find(root_moves.begin(), root_moves.end(), m);
+				rm.effort += nodes.load(std::memory_order_relaxed) - nodes_before;
+
+				if (move_count == 1 || value > alpha) {
+					if (move_count > 1 && !pv_idx)
+						++best_move_changes;
+
+					rm.score = value;
+					rm.average_score = rm.average_score == -VALUE_INFINITE ? value : (2 * value + rm.average_score) / 3;
+					rm.sel_depth = sel_depth;
+					rm.pv.resize(1);
+
+					for (move* p = (ss + 1)->pv; *p != move::none(); ++p)
+						rm.pv.push_back(*p);
+				}
+				else
+					rm.score = -VALUE_INFINITE;
+			}
+
+			if (value > best_value) {
+				best_value = value;
+
+				if (value > alpha) {
+					best_move = m;
+
+					if (pv_node && !root_node)
+						update_pv(ss->pv, m, (ss + 1)->pv);
+
+					if (value >= beta) {
+						++cutoffs;
+						first_move_cutoffs += move_count == 1;
+						break;
+					}
+
+					alpha = value;
+				}
+			}
+
+			if (m != best_move) {
+				if (capture && capture_count < 32)
+					captures_searched[capture_count++] = m;
+				else if (!capture && quiet_count < 64)
+					quiets_searched[quiet_count++] = m;
+			}
+		}
+
+		if (!move_count)
+			best_value = ss->in_check ? mated_in(ss->ply) : VALUE_DRAW;
+		else if (best_move)
+			update_all_stats(pos, ss, best_move, quiets_searched, quiet_count, captures_searched, capture_count, depth);
+
+		if (pv_node)
+			best_value = std::min(best_value, max_value);
+
+		//teach the correction tables how wrong the static eval was, but only when the bound actually says so:
+		//a fail high below the eval or a fail low above it tells us nothing, and captures are the qsearch's business
+		if (!ss->in_check && !(root_node && pv_idx) && !(best_move && pos.capture_stage(best_move))
+			&& std::abs(best_value) < VALUE_TB_WIN_IN_MAX_PLY
+			&& !(best_value >= beta && best_value <= ss->static_eval)
+			&& !(!best_move && best_value >= ss->static_eval))
+			update_correction_history(pos, (best_value - ss->static_eval) * depth / 8);
+
+		//the later multipv lines only searched some of the root moves, their result isn't the root's value
+		if (!(root_node && pv_idx))
+			writer.write(key, value_to_tt(best_value, ss->ply), pv_node,
+				best_value >= beta ? BOUND_LOWER : pv_node && best_move ? BOUND_EXACT : BOUND_UPPER,
+				depth, best_move, raw_eval, tt.generation());
+
+		return best_value;
+	}
+
+	//only captures (or evasions) until the position is quiet, so the static eval at the leaves isn't taken in the middle of an exchange
+	template<search::worker::node_type nt>
+	int search::worker::qsearch(position& pos, stack* ss, int alpha, int beta) {
+		constexpr bool pv_node = nt == PV;
+
+		assert(-VALUE_INFINITE <= alpha && alpha < beta && beta <= VALUE_INFINITE);
+
+		move pv[MAX_PLY + 1];
+		state_info& st = states[ss->ply + 1];
+		int move_count = 0;
+		int best_value, futility_base;
+		move best_move = move::none();
+
+		if (pv_node) {
+			(ss + 1)->pv = pv;
+			ss->pv[0] = move::none();
+		}
+
+		ss->in_check = pos.checkers();
+		nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		++qnodes;
+		check_time();
+
+		if (pv_node && sel_depth < ss->ply + 1)
+			sel_depth = ss->ply + 1;
+
+		if (pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
+			return (ss->ply >= MAX_PLY && !ss->in_check) ? eval::evaluate(pos, eval_tables) : VALUE_DRAW;
+
+		const uint64_t key = pos.r_key();
+		auto [tt_hit, tt_data, writer] = tt.probe(key);
+		const int tt_value = tt_hit ? value_from_tt(tt_data.value, ss->ply) : VALUE_NONE;
+		const move tt_move = tt_hit ? tt_data._move : move::none();
+
+		if (!pv_node && tt_hit && tt_data.depth >= DEPTH_QS && tt_value != VALUE_NONE
+			&& (tt_data._bound & (tt_value >= beta ? BOUND_LOWER : BOUND_UPPER)))
+			return tt_value;
+
+		int raw_eval = VALUE_NONE;
+		if (ss->in_check) {
+			//no standing pat in check, every evasion has to be looked at
+			ss->static_eval = VALUE_NONE;
+			best_value = futility_base = -VALUE_INFINITE;
+		}
+		else {
+			raw_eval = tt_hit && tt_data.eval != VALUE_NONE ? tt_data.eval : eval::evaluate(pos, eval_tables);
+			ss->static_eval = best_value = correct_eval(pos, raw_eval);
+
+			//the tt value is a better guess than the static eval when its bound points the right way
+			if (tt_value != VALUE_NONE && (tt_data._bound & (tt_value > best_value ? BOUND_LOWER : BOUND_UPPER)))
+				best_value = tt_value;
+
+			//stand pat, the side to move doesn't have to capture anything
+			if (best_value >= beta) {
+				if (!tt_hit)
+					writer.write(key, value_to_tt(best_value, ss->ply), false, BOUND_LOWER, DEPTH_QS,
+						move::none(), raw_eval, tt.generation());
+				return best_value;
+			}
+
+			if (best_value > alpha)
+				alpha = best_value;
+
+			futility_base = ss->static_eval + DELTA_MARGIN;
+		}
+
+		const piece_to_history* cont_hist[] = { (ss - 1)->continuation_history, (ss - 2)->continuation_history };
+		move_picker mp(pos, tt_move, DEPTH_QS, &main_history, &capture_hist, cont_hist);
+		move m;
+
+		while ((m = mp.next_move()) != move::none()) {
+			if (!pos.legal(m))
+				continue;
+
+			const bool gives_check = pos.gives_check(m);
+			++move_count;
+
+			//once we know we aren't getting mated, prune captures that can't get us anywhere
+			if (best_value > VALUE_TB_LOSS_IN_MAX_PLY) {
+				if (!gives_check && futility_base > VALUE_TB_LOSS_IN_MAX_PLY && m.type_of() != PROMOTION) {
+					const int captured = m.type_of() == EN_PASSANT ? pawn_value : piece_value[pos.piece_on(m.to_sq())];
+					const int futility_value = futility_base + captured;
+
+					//delta pruning, winning the piece for free still leaves us below alpha
+					if (futility_value <= alpha) {
+						best_value = std::max(best_value, futility_value);
+						++delta_pruned;
+						continue;
+					}
+
+					//the margin alone doesn't get us there and the exchange doesn't win anything on top of it
+					if (futility_base <= alpha && !pos.see_ge(m, 1)) {
+						best_value = std::max(best_value, futility_base);
+						++delta_pruned;
+						continue;
+					}
+				}
+
+				//losing captures (and evasions that hang the piece) don't fix anything at the horizon
+				if (!pos.see_ge(m, -QS_SEE_MARGIN)) {
+					++see_pruned;
+					continue;
+				}
+			}
+
+			ss->current_move = m;
+			ss->continuation_history = cont_history->at(pos.moved_piece(m), m.to_sq());
+			pos.do_move(m, st, gives_check, &tt);
+			const int value = -qsearch<nt>(pos, ss + 1, -beta, -alpha);
+			pos.undo_move(m);
+
+			assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
+
+			if (value > best_value) {
+				best_value = value;
+
+				if (value > alpha) {
+					best_move = m;
+
+					if (pv_node)
+						update_pv(ss->pv, m, (ss + 1)->pv);
+
+					if (value >= beta)
+						break;
+
+					alpha = value;
+				}
+			}
+		}
+
+		//every evasion was illegal or pruned, when nothing was even tried its mate
+		if (ss->in_check && best_value == -VALUE_INFINITE) {
+			assert(!has_legal_moves(pos));
+			return mated_in(ss->ply);
+		}
+
+		writer.write(key, value_to_tt(best_value, ss->ply), pv_node,
+			best_value >= beta ? BOUND_LOWER : BOUND_UPPER, DEPTH_QS, best_move, raw_eval, tt.generation());
+
+		return best_value;
+	}
+
+	//the move that caused the cutoff (or raised alpha last) gets a bonus, everything of its kind tried before it a malus
+	//a quiet best move also punishes the captures that didn't work out, they were tried first for nothing
+	void search::worker::update_all_stats(const position& pos, stack* ss, move best_move, const move* quiets, int quiet_count,
+		const move* captures, int capture_count, int depth) {
+		const color us = pos.side_to_move();
+		const int bonus = stat_bonus(depth);
+
+		if (!pos.capture_stage(best_move)) {
+			update_quiet_stats(pos, ss, best_move, bonus);
+
+			for (int i = 0; i < quiet_count; i++) {
+				main_history.update(us, quiets[i], -bonus);
+				update_continuation_histories(ss, pos.moved_piece(quiets[i]), quiets[i].to_sq(), -bonus);
+			}
+		}
+		else
+			capture_hist.update(pos.moved_piece(best_move), best_move.to_sq(), captured_type(pos, best_move), bonus);
+
+		for (int i = 0; i < capture_count; i++)
+			capture_hist.update(pos.moved_piece(captures[i]), captures[i].to_sq(), captured_type(pos, captures[i]), -bonus);
+	}
+
+	void search::worker::update_quiet_stats(const position& pos, stack* ss, move m, int bonus) {
+		if (ss->killers[0] != m) {
+			ss->killers[1] = ss->killers[0];
+			ss->killers[0] = m;
+		}
+
+		main_history.update(pos.side_to_move(), m, bonus);
+		update_continuation_histories(ss, pos.moved_piece(m), m.to_sq(), bonus);
+
+		if ((ss - 1)->current_move.is_ok()) {
+			const square prev_sq = (ss - 1)->current_move.to_sq();
+			counter_moves.set(pos.piece_on(prev_sq), prev_sq, m);
+		}
+	}
+
+	//sentinel rows (null moves, above the root) are skipped so they stay zero
+	void search::worker::update_continuation_histories(stack* ss, piece pc, square to, int bonus) {
+		for (int i : { 1, 2 })
+			if ((ss - i)->current_move.is_ok())
+				(ss - i)->continuation_history->update(pc, to, bonus);
+	}
+
+	int search::worker::correct_eval(const position& pos, int raw_eval) const {
+		const color us = pos.side_to_move();
+		const int correction = PAWN_CORRECTION_WEIGHT * pawn_correction.get(us, pos.r_pawn_key())
+			+ MINOR_CORRECTION_WEIGHT * minor_correction.get(us, pos.r_minor_piece_key())
+			+ MAJOR_CORRECTION_WEIGHT * major_correction.get(us, pos.r_major_piece_key())
+			+ NON_PAWN_CORRECTION_WEIGHT * (non_pawn_correction[WHITE].get(us, pos.r_non_pawn_key(WHITE))
+				+ non_pawn_correction[BLACK].get(us, pos.r_non_pawn_key(BLACK)));
+
+		//never let a correction turn an ordinary eval into something that looks like a tb or mate score
+		return std::clamp(raw_eval + correction / CORRECTION_SCALE, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+	}
+
+	void search::worker::update_correction_history(const position& pos, int bonus) {
+		const color us = pos.side_to_move();
+		bonus = std::clamp(bonus, -CORRECTION_HISTORY_MAX / 4, CORRECTION_HISTORY_MAX / 4);
+
+		pawn_correction.update(us, pos.r_pawn_key(), bonus);
+		minor_correction.update(us, pos.r_minor_piece_key(), bonus);
+		major_correction.update(us, pos.r_major_piece_key(), bonus);
+		non_pawn_correction[WHITE].update(us, pos.r_non_pawn_key(WHITE), bonus);
+		non_pawn_correction[BLACK].update(us, pos.r_non_pawn_key(BLACK), bonus);
+	}
+
+	void search::worker::check_time() {
+		//the clock isn't free, only look at it every so often
+		if ((nodes.load(std::memory_order_relaxed) & 1023) || ponder)
+			return;
+
+		const time_point elapsed = timer.elapsed();
+
+		//root_moves[0] always holds a legal move, so stopping in the middle of an iteration is safe
+		if ((limits.nodes && nodes.load(std::memory_order_relaxed) >= limits.nodes)
+			|| (limits.movetime && elapsed >= limits.movetime)
+			|| (limits.use_time_management() && (elapsed >= timer.maximum() || stop_on_ponderhit)))
+			stop = true;
+	}
+
+	//the opponent played the move we were pondering on, the search carries on as a normal timed one
+	//the clock started with go ponder, so the time spent pondering already counts towards this move's budget
+	void search::worker::ponderhit() {
+		ponder = false;
+
+		if (stop_on_ponderhit)
+			stop = true;
+	}
+
+	//go mate, the proof number solver instead of alpha-beta. it either proves a mate or says it couldn't,
+	//without a proof the first legal move goes out as bestmove
+	void search::worker::mate_search() {
+		std::vector<move> moves;
+		for (const auto& rm : root_moves)
+			moves.push_back(rm.pv[0]);
+
+		const time_point deadline = limits.movetime ? limits.start_time + limits.movetime : 0;
+		const mate::result r = mate_solver.solve(root_pos, moves, limits.mate, stop, deadline, limits.nodes);
+		const time_point elapsed = std::max<time_point>(now() - limits.start_time, 1);
+
+		nodes.store(mate_solver.nodes, std::memory_order_relaxed);
+
+		if (!r.moves || r.pv.empty()) {
+			sync_cout << "info string " << (r.aborted ? "stopped before finding a" : "no") << " mate in " << limits.mate
+				<< " with checks only, nodes " << mate_solver.nodes << " time " << elapsed << sync_endl;
+			return;
+		}
+
+		auto it = std::find(root_moves.begin(), root_moves.end(), r.pv[0]);
+		assert(it != root_moves.end()); //the solver only plays root moves at the root
+		it->pv = r.pv;
+		it->score = mate_in(2 * r.moves - 1);
+		std::rotate(root_moves.begin(), it, it + 1);
+
+		std::stringstream ss;
+		ss << "info depth " << 2 * r.moves - 1
+			<< " score " << score_to_uci(root_moves[0].score)
+			<< " nodes " << mate_solver.nodes
+			<< " nps " << mate_solver.nodes * 1000 / elapsed
+			<< " time " << elapsed
+			<< " pv";
+
+		for (move m : r.pv)
+			ss << " " << uci_engine::n_move(m);
+
+		sync_cout << ss.str() << sync_endl;
+	}
+
+	//SearchMode mcts, nodes in the info lines are playouts
+	//it stops on the same limits as alpha-beta, depth being the length of the most visited line
+	void search::worker::mcts_search(const std::string& fen, const state_info& root_state) {
+		std::vector<move> moves;
+		for (const auto& rm : root_moves)
+			moves.push_back(rm.pv[0]);
+
+		const auto time_up = [&] {
+			if (ponder)
+				return false;
+
+			const time_point elapsed = timer.elapsed();
+			return (limits.movetime && elapsed >= limits.movetime)
+				|| (limits.use_time_management() && elapsed >= timer.optimum())
+				|| (limits.depth && int(mcts_tree.current().pv.size()) >= limits.depth);
+		};
+
+		mcts_tree.run(fen, root_state, moves, stop, limits.nodes, time_up, [&](const mcts::result& r) { print_info(r); });
+
+		const mcts::result r = mcts_tree.current();
+		nodes.store(r.playouts, std::memory_order_relaxed);
+		print_info(r);
+
+		auto it = std::find(root_moves.begin(), root_moves.end(), r.pv[0]);
+		it->pv = r.pv;
+		it->score = r.score;
+		std::rotate(root_moves.begin(), it, it + 1);
+
+		const time_point elapsed = std::max<time_point>(now() - limits.start_time, 1);
+		sync_cout << "info string mcts playouts " << r.playouts << " (" << r.playouts * 1000 / elapsed << "/s) evals " << r.evals
+			<< " collisions " << r.collisions << " threads " << std::max(1, mcts::options.threads) << sync_endl;
+	}
+
+	void search::worker::print_info(const mcts::result& r) const {
+		const time_point elapsed = std::max<time_point>(now() - limits.start_time, 1);
+
+		std::stringstream ss;
+		ss << "info depth " << r.pv.size()
+			<< " seldepth " << r.sel_depth
+			<< " score " << score_to_uci(r.score)
+			<< " nodes " << r.playouts
+			<< " nps " << r.playouts * 1000 / elapsed
+			<< " time " << elapsed
+			<< " pv";
+
+		for (move m : r.pv)
+			ss << " " << uci_engine::n_move(m);
+
+		sync_cout << ss.str() << sync_endl;
+	}
+
+	//one line per multipv line, best first
+	void search::worker::print_info(int depth) const {
+		const time_point elapsed = std::max<time_point>(now() - limits.start_time, 1);
+		const int hashfull = tt.hash_full();
+		const uint64_t searched = nodes.load(std::memory_order_relaxed);
+		const size_t lines = std::min(multi_pv, root_moves.size());
+
+		std::stringstream ss;
+		for (size_t i = 0; i < lines; ++i) {
+			const root_move& rm = root_moves[i];
+
+			if (i)
+				ss << "\n";
+
+			//a tablebase win or loss the search hasn't turned into a mate yet shows the root probe's score
+			const int score = tb_config.root_in_tb && std::abs(rm.score) <= VALUE_TB ? rm.tb_score : rm.score;
+
+			ss << "info depth " << depth
+				<< " seldepth " << rm.sel_depth
+				<< " multipv " << i + 1
+				<< " score " << score_to_uci(score)
+				<< " nodes " << searched
+				<< " nps " << searched * 1000 / elapsed
+				<< " hashfull " << hashfull
+				<< " tbhits " << tb_hits
+				<< " time " << elapsed
+				<< " pv";
+
+			for (move m : rm.pv)
+				ss << " " << uci_engine::n_move(m);
+		}
+
+		sync_cout << ss.str() << sync_endl;
+	}
+}
@@ -0,0 +1,167 @@
+#ifndef SEARCH_H_INC
+#define SEARCH_H_INC
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "evaluate.h"
+#include "history.h"
+#include "mate.h"
+#include "mcts.h"
+#include "nnue.h"
+#include "position.h"
+#include "tbprobe.h"
+#include "timeman.h"
+#include "trans_table.h"
+#include "types.h"
+
+namespace engine {
+	namespace search {
+		//what the gui asked for with go
+		struct limits_type {
+			bool use_time_management() const { return time[WHITE] || time[BLACK]; }
+
+			std::vector<std::string> search_moves;
+			time_point time[COLOR_NB] = {};
+			time_point inc[COLOR_NB] = {};
+			time_point movetime = 0;
+			time_point start_time = 0;
+			int movestogo = 0;
+			int depth = 0;
+			int mate = 0; //go mate, prove a mate in this many moves instead of searching
+			int perft = 0;
+			uint64_t nodes = 0;
+			bool infinite = false;
+			bool ponder_mode = false;
+		};
+
+		//selective search techniques, each one can be switched off from uci to see what it buys in branching factor and time to depth
+		struct pruning_options {
+			bool null_move = true;
+			bool lmr = true;
+			bool futility = true;
+			bool reverse_futility = true;
+			bool late_move = true;
+			bool see_quiet = true;
+			bool aspiration = true; //narrow root window around the last score, not pruning but it's switched the same way
+		};
+
+		extern pruning_options pruning;
+
+		void init(); //reduction table
+
+		//per ply info, ss - 1, ss - 2... are the plies above this one
+		struct stack {
+			move* pv;
+			piece_to_history* continuation_history; //row for the move played at this ply, the next two plies read it
+			int ply;
+			move current_move;
+			move killers[2];
+			int static_eval;
+			int move_count;
+			bool in_check;
+		};
+
+		//one per legal move at the root, sorted by score after every iteration so the best one gets searched first next time
+		struct root_move {
+			explicit root_move(move m) : pv(1, m) {}
+			bool operator==(const move& m) const { return pv[0] == m; }
+			bool operator<(const root_move& m) const { //descending
+				return m.score != score ? m.score < score : m.previous_score < previous_score;
+			}
+
+			int score = -VALUE_INFINITE;
+			int previous_score = -VALUE_INFINITE;
+			int average_score = -VALUE_INFINITE; //smoothed over iterations, where the aspiration window goes
+			int sel_depth = 0;
+			int tb_rank = 0; //from the dtz (or wdl) probe at the root, only the best ranked moves get searched
+			int tb_score = -VALUE_INFINITE; //what to show instead of the search score when the root is in the tablebases
+			uint64_t effort = 0; //nodes spent under this move, all iterations
+			std::vector<move> pv;
+		};
+
+		//does the actual searching, owns its position, state stack and history tables, shares the tt
+		class worker {
+		public:
+			explicit worker(transposition_table& _tt);
+
+			void clear(); //forget everything learned, for ucinewgame
+			void start_searching(const std::string& fen, const state_info& root_state, const limits_type& lim);
+			void ponderhit();
+
+			std::atomic<bool> stop;
+			std::atomic<bool> ponder; //searching the opponent's time, no clock applies until ponderhit
+			std::atomic<uint64_t> nodes; //written by the search thread only, read from the uci thread while it runs
+			uint64_t qnodes; //nodes spent in qsearch, also counted in nodes
+			uint64_t tb_hits;
+			size_t multi_pv; //how many best lines to find, from the MultiPV option
+
+		private:
+			enum node_type { NON_PV, PV, ROOT };
+
+			void iterative_deepening();
+			void mate_search();
+			void mcts_search(const std::string& fen, const state_info& root_state);
+			template<node_type nt>
+			int search(position& pos, stack* ss, int alpha, int beta, int depth);
+			template<node_type nt>
+			int qsearch(position& pos, stack* ss, int alpha, int beta);
+
+			void update_all_stats(const position& pos, stack* ss, move best_move, const move* quiets, int quiet_count,
+				const move* captures, int capture_count, int depth);
+			void update_quiet_stats(const position& pos, stack* ss, move m, int bonus);
+			void update_continuation_histories(stack* ss, piece pc, square to, int bonus);
+			int correct_eval(const position& pos, int raw_eval) const;
+			void update_correction_history(const position& pos, int bonus);
+			void check_time();
+			bool time_to_stop();
+			void print_info(int depth) const;
+			void print_info(const mcts::result& r) const;
+
+			limits_type limits;
+			time_manager timer;
+			std::atomic<bool> stop_on_ponderhit; //time ran out while pondering
+			position root_pos;
+			state_stack states;
+			nnue::accumulator_stack accumulators;
+			std::vector<root_move> root_moves;
+			tablebases::config tb_config;
+			transposition_table& tt;
+
+			butterfly_history main_history;
+			capture_history capture_hist;
+			std::unique_ptr<continuation_history> cont_history;
+			eval::tables eval_tables;
+			counter_move_history counter_moves;
+			correction_history pawn_correction, minor_correction, major_correction;
+			correction_history non_pawn_correction[COLOR_NB];
+			mate::solver mate_solver;
+			mcts::searcher mcts_tree;
+
+			//how the aspiration window did at each depth, research_nodes is what the failed tries cost
+			struct aspiration_stats {
+				int fail_highs, fail_lows;
+				uint64_t research_nodes;
+			};
+
+			aspiration_stats asp_stats[MAX_PLY];
+			int root_depth, sel_depth, completed_depth;
+			size_t pv_idx; //which of the multipv lines is being searched, the root skips the moves before it
+			int nmp_min_ply; //null moves are off for the side doing a verification search until this ply
+
+			//root stability, decides how much of the optimum time the move gets
+			double best_move_changes, previous_time_reduction;
+			int best_previous_score, last_best_move_depth;
+			int iter_values[4];
+			move last_best_move;
+			uint64_t delta_pruned, see_pruned;
+			uint64_t null_cutoffs, rfp_cutoffs, futility_pruned, lmp_skips, see_quiet_pruned, lmr_researches;
+			uint64_t cutoffs, first_move_cutoffs; //beta cutoffs in the main search and how many came from the first move tried
+		};
+	}
+}
+
+#endif
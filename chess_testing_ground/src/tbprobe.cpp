@@ -0,0 +1,1169 @@
+#include "tbprobe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+#include "bitboard.h"
+#include "move_gen.h"
+#include "search.h"
+#include "utils.h"
+
+//probing code follows the layout of the syzygy files as the generator writes them, see Ronald de Man's original probing code
+namespace engine {
+	tablebases::options_type tablebases::options;
+	int tablebases::max_cardinality = 0;
+
+	namespace {
+		using namespace tablebases;
+
+		constexpr int TB_PIECES = 7;
+		constexpr int MAX_DTZ = 1 << 18; //bigger than any dtz a table can hold, root ranks are built around it
+
+		enum tb_type { WDL, DTZ };
+
+		//per table flags, all but SINGLE_VALUE only mean something in dtz tables
+		enum tb_flag { STM = 1, MAPPED = 2, WIN_PLIES = 4, LOSS_PLIES = 8, WIDE = 16, SINGLE_VALUE = 128 };
+
+		constexpr std::string_view piece_to_char = " PNBRQK  pnbrqk";
+
+		int map_pawns[SQUARE_NB];
+		int map_b1h1h7[SQUARE_NB];
+		int map_a1d1d4[SQUARE_NB];
+		int map_kk[10][SQUARE_NB]; //[map_a1d1d4][SQUARE_NB]
+
+		int binomial[6][SQUARE_NB];       //[k][n] ways to pick k from n
+		int lead_pawn_idx[6][SQUARE_NB];  //[lead pawn count][SQUARE_NB]
+		int lead_pawns_size[6][4];        //[lead pawn count][FILE_A..FILE_D]
+
+		constexpr int wdl_to_value[] = { -VALUE_TB, VALUE_DRAW - 2, VALUE_DRAW, VALUE_DRAW + 2, VALUE_TB };
+
+		wdl_score operator-(wdl_score d) { return wdl_score(-int(d)); }
+		square flip_file(square s) { return square(int(s) ^ 7); }
+		square flip_rank(square s) { return square(int(s) ^ 56); }
+		int off_a1h8(square s) { return int(rank_of(s)) - int(file_of(s)); }
+		bool pawns_comp(square i, square j) { return map_pawns[i] < map_pawns[j]; }
+
+		//the files mix both byte orders, memcpy also takes care of the odd unaligned read
+		template<typename T>
+		T read_le(const void* addr) {
+			T v;
+			std::memcpy(&v, addr, sizeof(T));
+			return v;
+		}
+
+		template<typename T>
+		T read_be(const void* addr) {
+			uint8_t b[sizeof(T)];
+			std::memcpy(b, addr, sizeof(T));
+			T v = 0;
+			for (size_t i = 0; i < sizeof(T); ++i)
+				v = T((uint64_t(v) << 8) | b[i]);
+			return v;
+		}
+
+		//dtz tables don't store anything useful for zeroing moves, but the wdl of the position after one gives it
+		int dtz_before_zeroing(wdl_score wdl) {
+			return wdl == WDL_WIN ? 1
+				: wdl == WDL_CURSED_WIN ? 101
+				: wdl == WDL_BLESSED_LOSS ? -101
+				: wdl == WDL_LOSS ? -1 : 0;
+		}
+
+		template<typename T>
+		int sign_of(T v) { return (T(0) < v) - (v < T(0)); }
+
+		//little endian pointer into block_length[], one every span values
+		struct sparse_entry {
+			char block[4];
+			char offset[2];
+		};
+
+		static_assert(sizeof(sparse_entry) == 6, "sparse_entry must be 6 bytes");
+
+		using sym = uint16_t; //huffman symbol
+
+		//node of the pairing tree, two 12 bit children, a leaf keeps its value in the left one and 0xFFF in the right
+		struct lr {
+			uint8_t bytes[3];
+
+			sym left() const { return sym(((bytes[1] & 0xF) << 8) | bytes[0]); }
+			sym right() const { return sym((bytes[2] << 4) | (bytes[1] >> 4)); }
+		};
+
+		static_assert(sizeof(lr) == 3, "lr tree entry must be 3 bytes");
+
+		//a file mapped read only, nothing is ever copied out of it onto the heap
+		struct tb_file {
+			static std::string paths;
+
+			std::string name;
+
+			//looks for the file in every path, empty name if it isn't there
+			explicit tb_file(const std::string& f) {
+				std::stringstream ss(paths);
+				std::string path;
+
+				while (std::getline(ss, path, ';')) {
+					if (path.empty())
+						continue;
+
+					if (std::ifstream(path + "/" + f).good()) {
+						name = path + "/" + f;
+						return;
+					}
+				}
+			}
+
+			bool exists() const { return !name.empty(); }
+
+			//maps the whole file and checks the magic, returns the data after it or nullptr
+			uint8_t* map(void** base, HANDLE* mapping, tb_type type) const {
+				*base = nullptr;
+				*mapping = nullptr;
+
+				HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+					return nullptr;
+
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file, &size) || size.QuadPart % 64 != 16) {
+					sync_cout << "info string corrupt tablebase file " << name << sync_endl;
+					CloseHandle(file);
+					return nullptr;
+				}
+
+				HANDLE m = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				void* data = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+				CloseHandle(file); //the mapping keeps the file open
+
+				if (!data) {
+					sync_cout << "info string could not map tablebase file " << name << sync_endl;
+					if (m)
+						CloseHandle(m);
+					return nullptr;
+				}
+
+				constexpr uint8_t magics[][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+
+				if (std::memcmp(data, magics[type], 4)) {
+					sync_cout << "info string corrupt tablebase file " << name << sync_endl;
+					unmap(data, m);
+					return nullptr;
+				}
+
+				*base = data;
+				*mapping = m;
+				return static_cast<uint8_t*>(data) + 4;
+			}
+
+			static void unmap(void* base, HANDLE mapping) {
+				UnmapViewOfFile(base);
+				CloseHandle(mapping);
+			}
+		};
+
+		std::string tb_file::paths;
+
+		//how to decode one sub table: wdl has one per side to move, tables with pawns one per file of the leading pawn on top
+		//filled in when the file gets mapped
+		struct pairs_data {
+			uint8_t flags;                 //tb_flag
+			uint8_t max_sym_len;           //longest huffman code in bits
+			uint8_t min_sym_len;           //shortest, or the value itself for SINGLE_VALUE tables
+			uint32_t num_blocks;
+			size_t block_size;             //bytes
+			size_t span;                   //a sparse_index entry every span values
+			const sym* lowest_sym;         //lowest_sym[l] is the lowest symbol with a code of length l
+			const lr* btree;               //btree[s] is the pair s expands to
+			const uint16_t* block_length;  //values (minus one) in each block
+			uint32_t block_length_size;    //padded so sparse_index never points past the end
+			const sparse_entry* sparse_index;
+			size_t sparse_index_size;
+			const uint8_t* data;           //start of the compressed blocks
+			std::vector<uint64_t> base64;  //base64[l - min_sym_len] is the lowest code of length l, left aligned to 64 bits
+			std::vector<uint8_t> symlen;   //how many values (minus one) a symbol expands to
+			piece pieces[TB_PIECES];       //order the pieces are encoded in, also defines the groups
+			uint64_t group_idx[TB_PIECES + 1]; //multiplier for each group's index
+			int group_len[TB_PIECES + 1];  //pieces per group, zero terminated, KRKN -> 3, 1
+			uint16_t map_idx[4];           //dtz only, where each wdl's value map starts: win, loss, cursed win, blessed loss
+		};
+
+		//one per file, the cheap part is set up at init and the rest on first probe
+		template<tb_type type>
+		struct tb_table {
+			using ret = std::conditional_t<type == WDL, wdl_score, int>;
+			static constexpr int SIDES = type == WDL ? 2 : 1;
+
+			std::atomic<bool> ready{ false };
+			void* base = nullptr;
+			HANDLE mapping = nullptr;
+			const uint8_t* map = nullptr; //dtz value maps
+			uint64_t key = 0;  //material key with the stronger side (as named in the file) white
+			uint64_t key2 = 0; //and black
+			int piece_count = 0;
+			bool has_pawns = false;
+			bool has_unique_pieces = false;
+			uint8_t pawn_count[2] = {}; //[lead color, other color]
+			pairs_data items[SIDES][4]; //[stm][FILE_A..FILE_D, or 0 without pawns]
+
+			pairs_data* get(int stm, int f) { return &items[stm % SIDES][has_pawns ? f : 0]; }
+
+			tb_table() = default;
+			explicit tb_table(const std::string& code);
+			explicit tb_table(const tb_table<WDL>& wdl);
+
+			~tb_table() {
+				if (base)
+					tb_file::unmap(base, mapping);
+			}
+		};
+
+		template<>
+		tb_table<WDL>::tb_table(const std::string& code) {
+			state_info st;
+			position pos;
+
+			key = pos.set(code, WHITE, &st).r_material_key();
+			piece_count = pop_count(pos.pieces());
+			has_pawns = pos.pieces(PAWN);
+
+			for (color c : { WHITE, BLACK })
+				for (piece_type pt = PAWN; pt < KING; ++pt)
+					if (pop_count(pos.pieces(c, pt)) == 1)
+						has_unique_pieces = true;
+
+			//the side with fewer pawns leads, it compresses better
+			const bool c = !pos.count<PAWN>(BLACK) || (pos.count<PAWN>(WHITE) && pos.count<PAWN>(BLACK) >= pos.count<PAWN>(WHITE));
+
+			pawn_count[0] = uint8_t(pos.count<PAWN>(c ? WHITE : BLACK));
+			pawn_count[1] = uint8_t(pos.count<PAWN>(c ? BLACK : WHITE));
+
+			key2 = pos.set(code, BLACK, &st).r_material_key();
+		}
+
+		template<>
+		tb_table<DTZ>::tb_table(const tb_table<WDL>& wdl) {
+			key = wdl.key;
+			key2 = wdl.key2;
+			piece_count = wdl.piece_count;
+			has_pawns = wdl.has_pawns;
+			has_unique_pieces = wdl.has_unique_pieces;
+			pawn_count[0] = wdl.pawn_count[0];
+			pawn_count[1] = wdl.pawn_count[1];
+		}
+
+		//every table found, looked up by material key, open addressing with robin hood insertion
+		class tb_tables {
+			struct entry {
+				uint64_t key;
+				tb_table<WDL>* wdl;
+				tb_table<DTZ>* dtz;
+
+				template<tb_type type>
+				tb_table<type>* get() const {
+					if constexpr (type == WDL)
+						return wdl;
+					else
+						return dtz;
+				}
+			};
+
+			static constexpr int SIZE = 1 << 12;
+			static constexpr int OVERFLOW_SIZE = 1; //the last slot stays empty so lookups always stop
+
+			entry hash_table[SIZE + OVERFLOW_SIZE] = {};
+			std::deque<tb_table<WDL>> wdl_tables;
+			std::deque<tb_table<DTZ>> dtz_tables;
+
+			void insert(uint64_t key, tb_table<WDL>* wdl, tb_table<DTZ>* dtz) {
+				uint32_t home = uint32_t(key) & (SIZE - 1);
+				entry e{ key, wdl, dtz };
+
+				for (uint32_t bucket = home; bucket < SIZE + OVERFLOW_SIZE - 1; ++bucket) {
+					const uint64_t other_key = hash_table[bucket].key;
+					if (other_key == e.key || !hash_table[bucket].wdl) {
+						hash_table[bucket] = e;
+						return;
+					}
+
+					//whoever is further from home keeps the slot
+					const uint32_t other_home = uint32_t(other_key) & (SIZE - 1);
+					if (other_home > home) {
+						std::swap(e, hash_table[bucket]);
+						home = other_home;
+					}
+				}
+
+				sync_cout << "info string tablebase hash table full, " << e.key << " left out" << sync_endl;
+			}
+
+		public:
+			template<tb_type type>
+			tb_table<type>* get(uint64_t key) {
+				for (const entry* e = &hash_table[uint32_t(key) & (SIZE - 1)];; ++e)
+					if (e->key == key || !e->wdl)
+						return e->template get<type>();
+			}
+
+			void clear() {
+				std::fill(std::begin(hash_table), std::end(hash_table), entry{});
+				wdl_tables.clear();
+				dtz_tables.clear();
+			}
+
+			size_t size() const { return wdl_tables.size(); }
+
+			//only the wdl file has to exist, a missing dtz file just fails dtz probes
+			void add(const std::vector<piece_type>& pieces) {
+				std::string code;
+				for (piece_type pt : pieces)
+					code += piece_to_char[pt];
+				code.insert(code.find('K', 1), "v"); //KRK -> KRvK
+
+				if (!tb_file(code + ".rtbw").exists())
+					return;
+
+				max_cardinality = std::max(int(pieces.size()), max_cardinality);
+
+				wdl_tables.emplace_back(code);
+				dtz_tables.emplace_back(wdl_tables.back());
+
+				insert(wdl_tables.back().key, &wdl_tables.back(), &dtz_tables.back());
+				insert(wdl_tables.back().key2, &wdl_tables.back(), &dtz_tables.back());
+			}
+		};
+
+		tb_tables tables;
+
+		//values are canonical huffman coded in blocks, each symbol stands for one value or, by recursive pairing,
+		//for a pair of other symbols. a block expands to at most 65536 values.
+		//sparse_index gets us close to the right block, then we walk the block lengths the rest of the way
+		int decompress_pairs(const pairs_data* d, uint64_t idx) {
+			if (d->flags & SINGLE_VALUE)
+				return d->min_sym_len;
+
+			//sparse_index[k] points at the value k * span + span / 2
+			const uint32_t k = uint32_t(idx / d->span);
+
+			uint32_t block = read_le<uint32_t>(&d->sparse_index[k].block);
+			int offset = read_le<uint16_t>(&d->sparse_index[k].offset);
+
+			offset += int(idx % d->span) - int(d->span / 2);
+
+			while (offset < 0)
+				offset += d->block_length[--block] + 1;
+
+			while (offset > d->block_length[block])
+				offset -= d->block_length[block++] + 1;
+
+			const uint8_t* ptr = d->data + uint64_t(block) * d->block_size;
+
+			//the block starts with a symbol, read 64 bits at a time and find each code's length from base64
+			uint64_t buf64 = read_be<uint64_t>(ptr);
+			ptr += 8;
+			int buf64_size = 64;
+			sym s;
+
+			while (true) {
+				int len = 0; //code length - min_sym_len
+
+				while (buf64 < d->base64[len])
+					++len;
+
+				//codes of the same length are consecutive, so the offset from the lowest one gives the symbol
+				s = sym((buf64 - d->base64[len]) >> (64 - len - d->min_sym_len));
+				s += read_le<sym>(&d->lowest_sym[len]);
+
+				if (offset < d->symlen[s] + 1)
+					break;
+
+				offset -= d->symlen[s] + 1;
+				len += d->min_sym_len;
+				buf64 <<= len;
+				buf64_size -= len;
+
+				if (buf64_size <= 32) {
+					buf64_size += 32;
+					buf64 |= uint64_t(read_be<uint32_t>(ptr)) << (64 - buf64_size);
+					ptr += 4;
+				}
+			}
+
+			//walk down the pairs to the leaf that holds our value
+			while (d->symlen[s]) {
+				const sym left = d->btree[s].left();
+
+				if (offset < d->symlen[left] + 1)
+					s = left;
+				else {
+					offset -= d->symlen[left] + 1;
+					s = d->btree[s].right();
+				}
+			}
+
+			return d->btree[s].left();
+		}
+
+		bool check_dtz_stm(tb_table<WDL>*, int, int) { return true; }
+
+		//dtz tables only keep one side to move, unless it's symmetric and pawnless
+		bool check_dtz_stm(tb_table<DTZ>* e, int stm, int f) {
+			const int flags = e->get(stm, f)->flags;
+			return (flags & STM) == stm || (e->key == e->key2 && !e->has_pawns);
+		}
+
+		wdl_score map_score(tb_table<WDL>*, int, int value, wdl_score) { return wdl_score(value - 2); }
+
+		//dtz values are stored by frequency, the map turns them back into real distances, then moves are made plies
+		int map_score(tb_table<DTZ>* e, int f, int value, wdl_score wdl) {
+			constexpr int wdl_map[] = { 1, 3, 0, 2, 0 };
+
+			const pairs_data* d = e->get(0, f);
+			const int flags = d->flags;
+
+			if (flags & MAPPED) {
+				if (flags & WIDE)
+					value = read_le<uint16_t>(e->map + 2 * (d->map_idx[wdl_map[wdl + 2]] + value));
+				else
+					value = e->map[d->map_idx[wdl_map[wdl + 2]] + value];
+			}
+
+			if ((wdl == WDL_WIN && !(flags & WIN_PLIES))
+				|| (wdl == WDL_LOSS && !(flags & LOSS_PLIES))
+				|| wdl == WDL_CURSED_WIN
+				|| wdl == WDL_BLESSED_LOSS)
+				value *= 2;
+
+			return value + 1;
+		}
+
+		//turn the position into the table's index and look it up
+		//pieces of one group go in sorted, k of them as binomial[1][s1] + binomial[2][s2] + ... + binomial[k][sk]
+		template<typename T, typename ret = typename T::ret>
+		ret do_probe_table(const position& pos, T* e, wdl_score wdl, probe_state* result) {
+			square squares[TB_PIECES];
+			piece pieces[TB_PIECES];
+			uint64_t idx;
+			int next = 0, size = 0, lead_pawns_cnt = 0;
+			bb b, lead_pawns = 0;
+			int tb_file_idx = FILE_A;
+
+			//tables are written with the stronger side white, and symmetric ones only with white to move,
+			//so flip colors and squares when the position is the other way around
+			const bool symmetric_black_to_move = e->key == e->key2 && pos.side_to_move() == BLACK;
+			const bool black_stronger = pos.r_material_key() != e->key;
+
+			const int flip_color = (symmetric_black_to_move || black_stronger) * 8;
+			const int flip_squares = (symmetric_black_to_move || black_stronger) * 56;
+			const int stm = (symmetric_black_to_move || black_stronger) ^ pos.side_to_move();
+
+			//with pawns there's a sub table per file of the leading pawn, the one nearest the edge and lowest
+			if (e->has_pawns) {
+				const piece pc = piece(e->get(0, 0)->pieces[0] ^ flip_color);
+				assert(type_of(pc) == PAWN);
+
+				lead_pawns = b = pos.pieces(color_of(pc), PAWN);
+				do
+					squares[size++] = square(int(pop_lsb(b)) ^ flip_squares);
+				while (b);
+
+				lead_pawns_cnt = size;
+
+				std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_cnt, pawns_comp));
+
+				tb_file_idx = edge_distance(file_of(squares[0]));
+			}
+
+			if (!check_dtz_stm(e, stm, tb_file_idx))
+				return *result = CHANGE_STM, ret();
+
+			b = pos.pieces() ^ lead_pawns;
+			do {
+				const square s = pop_lsb(b);
+				squares[size] = square(int(s) ^ flip_squares);
+				pieces[size++] = piece(int(pos.piece_on(s)) ^ flip_color);
+			} while (b);
+
+			assert(size >= 2);
+
+			pairs_data* d = e->get(stm, tb_file_idx);
+
+			//put the pieces in the order the table encodes them
+			for (int i = lead_pawns_cnt; i < size - 1; ++i)
+				for (int j = i + 1; j < size; ++j)
+					if (d->pieces[i] == pieces[j]) {
+						std::swap(pieces[i], pieces[j]);
+						std::swap(squares[i], squares[j]);
+						break;
+					}
+
+			//the lead piece goes in the a1-d1-d4 triangle
+			if (file_of(squares[0]) > FILE_D)
+				for (int i = 0; i < size; ++i)
+					squares[i] = flip_file(squares[i]);
+
+			if (e->has_pawns) {
+				idx = lead_pawn_idx[lead_pawns_cnt][squares[0]];
+
+				std::stable_sort(squares + 1, squares + lead_pawns_cnt, pawns_comp);
+
+				for (int i = 1; i < lead_pawns_cnt; ++i)
+					idx += binomial[i][map_pawns[squares[i]]];
+			}
+			else {
+				if (rank_of(squares[0]) > RANK_4)
+					for (int i = 0; i < size; ++i)
+						squares[i] = flip_rank(squares[i]);
+
+				//first lead group piece off the a1-h8 diagonal has to end up below it
+				for (int i = 0; i < d->group_len[0]; ++i) {
+					if (!off_a1h8(squares[i]))
+						continue;
+
+					if (off_a1h8(squares[i]) > 0)
+						for (int j = i; j < size; ++j)
+							squares[j] = square(((squares[j] >> 3) | (squares[j] << 3)) & 63);
+					break;
+				}
+
+				//three unique pieces (kings included) are encoded together, otherwise just the two kings
+				//a square "after" an earlier one is moved down one, there's one square fewer left for it
+				if (e->has_unique_pieces) {
+					const int adjust1 = squares[1] > squares[0];
+					const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+					if (off_a1h8(squares[0]))
+						idx = (map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+					else if (off_a1h8(squares[1]))
+						idx = (6 * 63 + rank_of(squares[0]) * 28 + map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+					else if (off_a1h8(squares[2]))
+						idx = 6 * 63 * 62 + 4 * 28 * 62
+							+ rank_of(squares[0]) * 7 * 28
+							+ (rank_of(squares[1]) - adjust1) * 28
+							+ map_b1h1h7[squares[2]];
+					else
+						idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+							+ rank_of(squares[0]) * 7 * 6
+							+ (rank_of(squares[1]) - adjust1) * 6
+							+ (rank_of(squares[2]) - adjust2);
+				}
+				else
+					idx = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+			}
+
+			idx *= d->group_idx[0];
+			square* group_sq = squares + d->group_len[0];
+
+			//the rest of the groups, other side's pawns first if there are any
+			bool remaining_pawns = e->has_pawns && e->pawn_count[1];
+
+			while (d->group_len[++next]) {
+				std::stable_sort(group_sq, group_sq + d->group_len[next]);
+				uint64_t n = 0;
+
+				for (int i = 0; i < d->group_len[next]; ++i) {
+					const auto adjust = std::count_if(squares, group_sq, [&](square s) { return group_sq[i] > s; });
+					n += binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+				}
+
+				remaining_pawns = false;
+				idx += n * d->group_idx[next];
+				group_sq += d->group_len[next];
+			}
+
+			return map_score(e, tb_file_idx, decompress_pairs(d, idx), wdl);
+		}
+
+		//pieces of the same type and color form a group, except the lead group that can be three unique pieces
+		//or the two kings. the table stores which order the groups are multiplied together in
+		template<typename T>
+		void set_groups(T& e, pairs_data* d, const int order[], int f) {
+			int n = 0, first_len = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+			d->group_len[n] = 1;
+
+			for (int i = 1; i < e.piece_count; ++i)
+				if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1])
+					d->group_len[n]++;
+				else
+					d->group_len[++n] = 1;
+
+			d->group_len[++n] = 0;
+
+			const bool pp = e.has_pawns && e.pawn_count[1];
+			int next = pp ? 2 : 1;
+			int free_squares = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+			uint64_t idx = 1;
+
+			for (int k = 0; next < n || k == order[0] || k == order[1]; ++k)
+				if (k == order[0]) { //leading pawns or pieces
+					d->group_idx[0] = idx;
+					idx *= e.has_pawns ? lead_pawns_size[d->group_len[0]][f] : e.has_unique_pieces ? 31332 : 462;
+				}
+				else if (k == order[1]) { //the other side's pawns
+					d->group_idx[1] = idx;
+					idx *= binomial[d->group_len[1]][48 - d->group_len[0]];
+				}
+				else { //the remaining pieces
+					d->group_idx[next] = idx;
+					idx *= binomial[d->group_len[next]][free_squares];
+					free_squares -= d->group_len[next++];
+				}
+
+			d->group_idx[n] = idx;
+		}
+
+		uint8_t set_symlen(pairs_data* d, sym s, std::vector<bool>& visited) {
+			visited[s] = true; //the tree has no cycles
+
+			const sym sr = d->btree[s].right();
+			if (sr == 0xFFF)
+				return 0;
+
+			const sym sl = d->btree[s].left();
+
+			if (!visited[sl])
+				d->symlen[sl] = set_symlen(d, sl, visited);
+			if (!visited[sr])
+				d->symlen[sr] = set_symlen(d, sr, visited);
+
+			return uint8_t(d->symlen[sl] + d->symlen[sr] + 1);
+		}
+
+		const uint8_t* set_sizes(pairs_data* d, const uint8_t* data) {
+			d->flags = *data++;
+
+			if (d->flags & SINGLE_VALUE) {
+				d->num_blocks = d->block_length_size = 0;
+				d->span = d->sparse_index_size = 0;
+				d->min_sym_len = *data++; //the one value
+				return data;
+			}
+
+			//the last group_idx is the table size
+			const uint64_t tb_size = d->group_idx[std::find(d->group_len, d->group_len + TB_PIECES, 0) - d->group_len];
+
+			d->block_size = size_t(1) << *data++;
+			d->span = size_t(1) << *data++;
+			d->sparse_index_size = size_t((tb_size + d->span - 1) / d->span);
+			const uint8_t padding = *data++;
+			d->num_blocks = read_le<uint32_t>(data);
+			data += sizeof(uint32_t);
+			d->block_length_size = d->num_blocks + padding;
+			d->max_sym_len = *data++;
+			d->min_sym_len = *data++;
+			d->lowest_sym = reinterpret_cast<const sym*>(data);
+			d->base64.resize(d->max_sym_len - d->min_sym_len + 1);
+
+			//canonical huffman: longer codes have lower values, so base64 falls as the length grows
+			for (int i = int(d->base64.size()) - 2; i >= 0; --i) {
+				d->base64[i] = (d->base64[i + 1] + read_le<sym>(&d->lowest_sym[i]) - read_le<sym>(&d->lowest_sym[i + 1])) / 2;
+				assert(d->base64[i] * 2 >= d->base64[i + 1]);
+			}
+
+			for (size_t i = 0; i < d->base64.size(); ++i)
+				d->base64[i] <<= 64 - i - d->min_sym_len;
+
+			data += d->base64.size() * sizeof(sym);
+			d->symlen.resize(read_le<uint16_t>(data));
+			data += sizeof(uint16_t);
+			d->btree = reinterpret_cast<const lr*>(data);
+
+			std::vector<bool> visited(d->symlen.size());
+			for (size_t s = 0; s < d->symlen.size(); ++s)
+				if (!visited[s])
+					d->symlen[s] = set_symlen(d, sym(s), visited);
+
+			return data + d->symlen.size() * sizeof(lr) + (d->symlen.size() & 1);
+		}
+
+		const uint8_t* set_dtz_map(tb_table<WDL>&, const uint8_t* data, int) { return data; }
+
+		const uint8_t* set_dtz_map(tb_table<DTZ>& e, const uint8_t* data, int max_file) {
+			e.map = data;
+
+			for (int f = FILE_A; f <= max_file; ++f) {
+				pairs_data* d = e.get(0, f);
+				if (!(d->flags & MAPPED))
+					continue;
+
+				if (d->flags & WIDE) {
+					data += uintptr_t(data) & 1; //16 bit maps are word aligned
+					for (int i = 0; i < 4; ++i) {
+						d->map_idx[i] = uint16_t((data - e.map) / 2 + 1);
+						data += 2 * read_le<uint16_t>(data) + 2;
+					}
+				}
+				else {
+					for (int i = 0; i < 4; ++i) {
+						d->map_idx[i] = uint16_t(data - e.map + 1);
+						data += *data + 1;
+					}
+				}
+			}
+
+			return data + (uintptr_t(data) & 1);
+		}
+
+		//reads the header of a freshly mapped file into the table's pairs_data
+		template<typename T>
+		void set(T& e, const uint8_t* data) {
+			enum { SPLIT = 1, HAS_PAWNS = 2 };
+
+			assert(e.has_pawns == bool(*data & HAS_PAWNS));
+			assert((e.key != e.key2) == bool(*data & SPLIT));
+
+			data++; //flags
+
+			const int sides = T::SIDES == 2 && e.key != e.key2 ? 2 : 1;
+			const int max_file = e.has_pawns ? FILE_D : FILE_A;
+			const bool pp = e.has_pawns && e.pawn_count[1];
+
+			for (int f = FILE_A; f <= max_file; ++f) {
+				for (int i = 0; i < sides; i++)
+					*e.get(i, f) = pairs_data();
+
+				const int order[][2] = { { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+										 { *data >> 4, pp ? *(data + 1) >> 4 : 0xF } };
+				data += 1 + pp;
+
+				for (int k = 0; k < e.piece_count; ++k, ++data)
+					for (int i = 0; i < sides; i++)
+						e.get(i, f)->pieces[k] = piece(i ? *data >> 4 : *data & 0xF);
+
+				for (int i = 0; i < sides; ++i)
+					set_groups(e, e.get(i, f), order[i], f);
+			}
+
+			data += uintptr_t(data) & 1;
+
+			for (int f = FILE_A; f <= max_file; ++f)
+				for (int i = 0; i < sides; i++)
+					data = set_sizes(e.get(i, f), data);
+
+			data = set_dtz_map(e, data, max_file);
+
+			for (int f = FILE_A; f <= max_file; ++f)
+				for (int i = 0; i < sides; i++) {
+					pairs_data* d = e.get(i, f);
+					d->sparse_index = reinterpret_cast<const sparse_entry*>(data);
+					data += d->sparse_index_size * sizeof(sparse_entry);
+				}
+
+			for (int f = FILE_A; f <= max_file; ++f)
+				for (int i = 0; i < sides; i++) {
+					pairs_data* d = e.get(i, f);
+					d->block_length = reinterpret_cast<const uint16_t*>(data);
+					data += d->block_length_size * sizeof(uint16_t);
+				}
+
+			for (int f = FILE_A; f <= max_file; ++f)
+				for (int i = 0; i < sides; i++) {
+					data = reinterpret_cast<const uint8_t*>((uintptr_t(data) + 0x3F) & ~uintptr_t(0x3F)); //blocks start on a cache line
+					pairs_data* d = e.get(i, f);
+					d->data = data;
+					data += uint64_t(d->num_blocks) * d->block_size;
+				}
+		}
+
+		//maps the file the first time the table is needed, nullptr if that failed
+		template<tb_type type>
+		void* mapped(tb_table<type>& e, const position& pos) {
+			static std::mutex mutex;
+
+			if (e.ready.load(std::memory_order_acquire))
+				return e.base;
+
+			std::lock_guard<std::mutex> lk(mutex);
+
+			if (e.ready.load(std::memory_order_relaxed))
+				return e.base;
+
+			//pieces in decreasing order for each side, KRvK
+			std::string w, b;
+			for (piece_type pt = KING; pt >= PAWN; --pt) {
+				w += std::string(pop_count(pos.pieces(WHITE, pt)), piece_to_char[pt]);
+				b += std::string(pop_count(pos.pieces(BLACK, pt)), piece_to_char[pt]);
+			}
+
+			const std::string name = (e.key == pos.r_material_key() ? w + 'v' + b : b + 'v' + w) + (type == WDL ? ".rtbw" : ".rtbz");
+
+			const tb_file file(name);
+			const uint8_t* data = file.exists() ? file.map(&e.base, &e.mapping, type) : nullptr;
+
+			if (data)
+				set(e, data);
+
+			e.ready.store(true, std::memory_order_release);
+			return e.base;
+		}
+
+		template<tb_type type, typename ret = typename tb_table<type>::ret>
+		ret probe_table(const position& pos, probe_state* result, wdl_score wdl = WDL_DRAW) {
+			if (pop_count(pos.pieces()) == 2) //KvK
+				return ret(WDL_DRAW);
+
+			tb_table<type>* e = tables.get<type>(pos.r_material_key());
+
+			if (!e || !mapped(*e, pos))
+				return *result = FAIL, ret();
+
+			return do_probe_table(pos, e, wdl, result);
+		}
+
+		//the generator doesn't bother storing the right value where the side to move has a winning capture,
+		//or a drawing one in a drawn position, it stores whatever compresses best. so captures (and for dtz,
+		//pawn moves) have to be searched and the best of them and the stored value is the real result
+		template<bool check_zeroing_moves>
+		wdl_score search_zeroing(position& pos, probe_state* result) {
+			wdl_score value, best_value = WDL_LOSS;
+			state_info st;
+
+			const move_list<LEGAL> moves(pos);
+			size_t move_count = 0;
+
+			for (const move m : moves) {
+				if (!pos.capture(m) && (!check_zeroing_moves || type_of(pos.moved_piece(m)) != PAWN))
+					continue;
+
+				move_count++;
+
+				pos.do_move(m, st);
+				value = -search_zeroing<false>(pos, result);
+				pos.undo_move(m);
+
+				if (*result == FAIL)
+					return WDL_DRAW;
+
+				if (value > best_value) {
+					best_value = value;
+
+					if (value >= WDL_WIN) {
+						*result = ZEROING_BEST_MOVE;
+						return value;
+					}
+				}
+			}
+
+			//every legal move was searched, the stored value could be wrong (en passant positions aren't in the tables at all)
+			const bool no_more_moves = move_count && move_count == moves.size();
+
+			if (no_more_moves)
+				value = best_value;
+			else {
+				value = probe_table<WDL>(pos, result);
+
+				if (*result == FAIL)
+					return WDL_DRAW;
+			}
+
+			if (best_value >= value)
+				return *result = (best_value > WDL_DRAW || no_more_moves ? ZEROING_BEST_MOVE : OK), best_value;
+
+			return *result = OK, value;
+		}
+
+		//ranks root moves by dtz, false if a probe failed
+		bool root_probe(position& pos, std::vector<search::root_move>& root_moves, bool rule50) {
+			probe_state result = OK;
+			state_info st;
+
+			const int cnt50 = pos.move_rule_50_count();
+			const bool rep = pos.has_repeated();
+			const int bound = rule50 ? MAX_DTZ - 100 : 1;
+
+			for (auto& rm : root_moves) {
+				pos.do_move(rm.pv[0], st);
+
+				int dtz;
+				if (pos.move_rule_50_count() == 0) //zeroing move, dtz is one of -101/-1/0/1/101
+					dtz = dtz_before_zeroing(-probe_wdl(pos, &result));
+				else if (pos.is_draw(1)) //repetition in the game history or the 50 move rule
+					dtz = 0;
+				else {
+					dtz = -probe_dtz(pos, &result);
+					dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+				}
+
+				//mate in one gets dtz 1
+				if (pos.checkers() && dtz == 2 && !has_legal_moves(pos))
+					dtz = 1;
+
+				pos.undo_move(rm.pv[0]);
+
+				if (result == FAIL)
+					return false;
+
+				//certain wins rank the same, so the search picks among them, losses too unless a 50 move draw is in reach
+				const int r = dtz > 0 ? (dtz + cnt50 <= 99 && !rep ? MAX_DTZ : MAX_DTZ - (dtz + cnt50))
+					: dtz < 0 ? (-dtz * 2 + cnt50 < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + cnt50))
+					: 0;
+				rm.tb_rank = r;
+
+				//cursed wins and blessed losses show a small score that grows as the 50 move draw gets further away
+				rm.tb_score = r >= bound ? VALUE_TB
+					: r > 0 ? (std::max(3, r - (MAX_DTZ - 200)) * pawn_value) / 200
+					: r == 0 ? VALUE_DRAW
+					: r > -bound ? (std::min(-3, r + (MAX_DTZ - 200)) * pawn_value) / 200
+					: -VALUE_TB;
+			}
+
+			return true;
+		}
+
+		//the same from wdl alone, for when dtz files are missing
+		bool root_probe_wdl(position& pos, std::vector<search::root_move>& root_moves, bool rule50) {
+			constexpr int wdl_to_rank[] = { -MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ };
+
+			probe_state result = OK;
+			state_info st;
+
+			for (auto& rm : root_moves) {
+				pos.do_move(rm.pv[0], st);
+
+				wdl_score wdl = pos.is_draw(1) ? WDL_DRAW : -probe_wdl(pos, &result);
+
+				pos.undo_move(rm.pv[0]);
+
+				if (result == FAIL)
+					return false;
+
+				rm.tb_rank = wdl_to_rank[wdl + 2];
+
+				if (!rule50)
+					wdl = wdl > WDL_DRAW ? WDL_WIN : wdl < WDL_DRAW ? WDL_LOSS : WDL_DRAW;
+				rm.tb_score = wdl_to_value[wdl + 2];
+			}
+
+			return true;
+		}
+	}
+
+	//(re)builds the table list, called whenever SyzygyPath changes
+	void tablebases::init(const std::string& paths) {
+		tables.clear();
+		max_cardinality = 0;
+		tb_file::paths = paths;
+
+		if (paths.empty() || paths == "<empty>")
+			return;
+
+		//squares below the a1-h8 diagonal to 0..27
+		int code = 0;
+		for (square s = SQ_A1; s <= SQ_H8; ++s)
+			if (off_a1h8(s) < 0)
+				map_b1h1h7[s] = code++;
+
+		//the a1-d1-d4 triangle to 0..9, diagonal squares last
+		std::vector<square> diagonal;
+		code = 0;
+		for (square s = SQ_A1; s <= SQ_D4; ++s)
+			if (off_a1h8(s) < 0 && file_of(s) <= FILE_D)
+				map_a1d1d4[s] = code++;
+			else if (!off_a1h8(s) && file_of(s) <= FILE_D)
+				diagonal.push_back(s);
+
+		for (square s : diagonal)
+			map_a1d1d4[s] = code++;
+
+		//the 462 legal king pairs with the first king in the triangle, both on the diagonal last
+		std::vector<std::pair<int, square>> both_on_diagonal;
+		code = 0;
+		for (int idx = 0; idx < 10; idx++)
+			for (square s1 = SQ_A1; s1 <= SQ_D4; ++s1)
+				if (map_a1d1d4[s1] == idx && (idx || s1 == SQ_B1)) { //b1 maps to 0
+					for (square s2 = SQ_A1; s2 <= SQ_H8; ++s2)
+						if ((attacks_bb<KING>(s1) | s1) & s2)
+							continue; //kings touching
+						else if (!off_a1h8(s1) && off_a1h8(s2) > 0)
+							continue; //first on the diagonal, second above it
+						else if (!off_a1h8(s1) && !off_a1h8(s2))
+							both_on_diagonal.emplace_back(idx, s2);
+						else
+							map_kk[idx][s2] = code++;
+				}
+
+		for (const auto& p : both_on_diagonal)
+			map_kk[p.first][p.second] = code++;
+
+		binomial[0][0] = 1;
+		for (int n = 1; n < 64; n++)
+			for (int k = 0; k < 6 && k <= n; ++k)
+				binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+		//a2-h7 to 0..47, the highest is the leading pawn, nearest the edge and lowest on its file
+		int available_squares = 47;
+
+		for (int lead_pawns_cnt = 1; lead_pawns_cnt <= 5; ++lead_pawns_cnt)
+			for (file f = FILE_A; f <= FILE_D; ++f) {
+				int idx = 0;
+
+				for (rank r = RANK_2; r <= RANK_7; ++r) {
+					const square sq = make_square(f, r);
+
+					if (lead_pawns_cnt == 1) {
+						map_pawns[sq] = available_squares--;
+						map_pawns[flip_file(sq)] = available_squares--;
+					}
+					lead_pawn_idx[lead_pawns_cnt][sq] = idx;
+					idx += binomial[lead_pawns_cnt - 1][map_pawns[sq]];
+				}
+
+				lead_pawns_size[lead_pawns_cnt][f] = idx;
+			}
+
+		//every material combination up to 7 pieces, strongest side first
+		for (piece_type p1 = PAWN; p1 < KING; ++p1) {
+			tables.add({ KING, p1, KING });
+
+			for (piece_type p2 = PAWN; p2 <= p1; ++p2) {
+				tables.add({ KING, p1, p2, KING });
+				tables.add({ KING, p1, KING, p2 });
+
+				for (piece_type p3 = PAWN; p3 < KING; ++p3)
+					tables.add({ KING, p1, p2, KING, p3 });
+
+				for (piece_type p3 = PAWN; p3 <= p2; ++p3) {
+					tables.add({ KING, p1, p2, p3, KING });
+
+					for (piece_type p4 = PAWN; p4 <= p3; ++p4) {
+						tables.add({ KING, p1, p2, p3, p4, KING });
+
+						for (piece_type p5 = PAWN; p5 <= p4; ++p5)
+							tables.add({ KING, p1, p2, p3, p4, p5, KING });
+
+						for (piece_type p5 = PAWN; p5 < KING; ++p5)
+							tables.add({ KING, p1, p2, p3, p4, KING, p5 });
+					}
+
+					for (piece_type p4 = PAWN; p4 < KING; ++p4) {
+						tables.add({ KING, p1, p2, p3, KING, p4 });
+
+						for (piece_type p5 = PAWN; p5 <= p4; ++p5)
+							tables.add({ KING, p1, p2, p3, KING, p4, p5 });
+					}
+				}
+
+				for (piece_type p3 = PAWN; p3 <= p1; ++p3)
+					for (piece_type p4 = PAWN; p4 <= (p1 == p3 ? p2 : p3); ++p4)
+						tables.add({ KING, p1, p2, KING, p3, p4 });
+			}
+		}
+
+		sync_cout << "info string found " << tables.size() << " tablebases" << sync_endl;
+	}
+
+	//-2 loss, -1 blessed loss, 0 draw, 1 cursed win, 2 win, for the side to move
+	tablebases::wdl_score tablebases::probe_wdl(position& pos, probe_state* result) {
+		*result = OK;
+		return search_zeroing<false>(pos, result);
+	}
+
+	//distance to the next zeroing move in plies, signed like wdl, beyond +-100 means the 50 move rule draws it
+	//can be one ply too long, so a win is only certain while dtz + the 50 move counter stays <= 99
+	int tablebases::probe_dtz(position& pos, probe_state* result) {
+		*result = OK;
+		const wdl_score wdl = search_zeroing<true>(pos, result);
+
+		if (*result == FAIL || wdl == WDL_DRAW) //draws aren't stored
+			return 0;
+
+		//the best move zeroes, the stored value doesn't mean anything here
+		if (*result == ZEROING_BEST_MOVE)
+			return dtz_before_zeroing(wdl);
+
+		int dtz = probe_table<DTZ>(pos, result, wdl);
+
+		if (*result == FAIL)
+			return 0;
+
+		if (*result != CHANGE_STM)
+			return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * sign_of(wdl);
+
+		//the table is for the other side to move, take the best of our moves one ply down
+		state_info st;
+		int min_dtz = 0xFFFF;
+
+		for (const move m : move_list<LEGAL>(pos)) {
+			const bool zeroing = pos.capture(m) || type_of(pos.moved_piece(m)) == PAWN;
+
+			pos.do_move(m, st);
+
+			//for zeroing moves the sign comes from the wdl after them
+			dtz = zeroing ? -dtz_before_zeroing(search_zeroing<false>(pos, result)) : -probe_dtz(pos, result);
+
+			if (dtz == 1 && pos.checkers() && !has_legal_moves(pos))
+				min_dtz = 1;
+
+			if (!zeroing)
+				dtz += sign_of(dtz);
+
+			if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl))
+				min_dtz = dtz;
+
+			pos.undo_move(m);
+
+			if (*result == FAIL)
+				return 0;
+		}
+
+		return min_dtz == 0xFFFF ? -1 : min_dtz; //no legal moves, mated
+	}
+
+	//ranks the root moves with dtz (or wdl if dtz is missing) and drops the ones that give away the result
+	//the search still runs over what's left to pick the best of the equally ranked moves
+	tablebases::config tablebases::rank_root_moves(position& pos, std::vector<search::root_move>& root_moves) {
+		config cfg;
+		cfg.rule50 = options.rule50;
+		cfg.probe_depth = options.probe_depth;
+		cfg.cardinality = options.probe_limit;
+
+		bool dtz_available = true;
+
+		//smaller tables than the limit get probed at any depth
+		if (cfg.cardinality > max_cardinality) {
+			cfg.cardinality = max_cardinality;
+			cfg.probe_depth = 0;
+		}
+
+		if (cfg.cardinality >= pop_count(pos.pieces()) && !pos.can_castle(ANY_CASTLING)) {
+			cfg.root_in_tb = root_probe(pos, root_moves, cfg.rule50);
+
+			if (!cfg.root_in_tb) {
+				dtz_available = false;
+				cfg.root_in_tb = root_probe_wdl(pos, root_moves, cfg.rule50);
+			}
+		}
+
+		if (cfg.root_in_tb) {
+			std::stable_sort(root_moves.begin(), root_moves.end(),
+				[](const search::root_move& a, const search::root_move& b) { return a.tb_rank > b.tb_rank; });
+
+			const int best_rank = root_moves[0].tb_rank;
+			root_moves.erase(std::find_if(root_moves.begin(), root_moves.end(),
+				[&](const search::root_move& rm) { return rm.tb_rank < best_rank; }), root_moves.end());
+
+			//with dtz the root already knows everything, without it wins still need wdl probes to be converted
+			if (dtz_available || root_moves[0].tb_score <= VALUE_DRAW)
+				cfg.cardinality = 0;
+		}
+		else
+			for (auto& rm : root_moves)
+				rm.tb_rank = 0;
+
+		return cfg;
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef TBPROBE_H_INC
+#define TBPROBE_H_INC
+
+#include <string>
+#include <vector>
+
+#include "position.h"
+
+namespace engine {
+	namespace search {
+		struct root_move;
+	}
+
+	//syzygy tablebases, wdl for the search and dtz for the root
+	//files are found at init but only memory mapped the first time a position with that material gets probed
+	namespace tablebases {
+		enum wdl_score {
+			WDL_LOSS = -2,         //loss
+			WDL_BLESSED_LOSS = -1, //loss, but draw under the 50 move rule
+			WDL_DRAW = 0,
+			WDL_CURSED_WIN = 1,    //win, but draw under the 50 move rule
+			WDL_WIN = 2
+		};
+
+		enum probe_state {
+			FAIL = 0,              //probe failed, missing file
+			OK = 1,
+			CHANGE_STM = -1,       //dtz should check the other side
+			ZEROING_BEST_MOVE = 2  //best move zeroes the 50 move counter
+		};
+
+		//from the uci options
+		struct options_type {
+			int probe_depth = 1;
+			int probe_limit = 7;
+			bool rule50 = true;
+		};
+
+		//what the search should do for this go, decided at the root
+		struct config {
+			int cardinality = 0; //probe positions with at most this many pieces, 0 turns probing off
+			int probe_depth = 0;
+			bool root_in_tb = false;
+			bool rule50 = true;
+		};
+
+		extern options_type options;
+		extern int max_cardinality; //most pieces of any table found
+
+		void init(const std::string& paths); //paths split by ';'
+		wdl_score probe_wdl(position& pos, probe_state* result);
+		int probe_dtz(position& pos, probe_state* result);
+		config rank_root_moves(position& pos, std::vector<search::root_move>& root_moves);
+	}
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include "timeman.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "search.h"
+
+namespace engine {
+	//with no movestogo we plan as if there are 50 moves left, and spend a slowly growing share of the clock as the game goes on
+	//with movestogo the remaining time gets split over the moves left, leaving a cushion for the last ones
+	//the overhead is paid once per planned move, so a long sequence of fast increment moves can't add up to a flag
+	void search::time_manager::init(const limits_type& limits, color us, int ply) {
+		start_time = limits.start_time;
+
+		if (!limits.use_time_management())
+			return;
+
+		const time_point time = limits.time[us];
+		const time_point inc = limits.inc[us];
+		const int mtg = limits.movestogo ? std::min(limits.movestogo, 50) : 50;
+
+		const time_point time_left = std::max<time_point>(1, time + inc * (mtg - 1) - move_overhead * (2 + mtg));
+
+		double opt_scale, max_scale;
+		if (!limits.movestogo) {
+			opt_scale = std::min(0.0120 + std::pow(ply + 3.0, 0.45) * 0.0039, 0.2 * time / double(time_left));
+			max_scale = std::min(7.0, 4.0 + ply / 12.0);
+		}
+		else {
+			opt_scale = std::min((0.88 + ply / 116.4) / mtg, 0.88 * time / double(time_left));
+			max_scale = std::min(6.3, 1.5 + 0.11 * mtg);
+		}
+
+		optimum_time = std::max<time_point>(1, time_point(opt_scale * time_left));
+		maximum_time = std::max<time_point>(1, time_point(std::min(0.8 * time - move_overhead, max_scale * optimum_time)) - 10);
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef TIMEMAN_H_INC
+#define TIMEMAN_H_INC
+
+#include <chrono>
+#include <cstdint>
+
+#include "types.h"
+
+namespace engine {
+	namespace search {
+		using time_point = std::chrono::milliseconds::rep;
+
+		inline time_point now() {
+			return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		struct limits_type;
+
+		//splits what's left on the clock into a budget for this move
+		//optimum is what a normal move should take, the search stretches or shrinks it depending on how settled the root is
+		//maximum is the hard stop check_time enforces no matter what
+		class time_manager {
+		public:
+			void init(const limits_type& limits, color us, int ply);
+
+			time_point optimum() const { return optimum_time; }
+			time_point maximum() const { return maximum_time; }
+			time_point elapsed() const { return now() - start_time; }
+
+			static inline time_point move_overhead = 10; //lost per move between us and the clock (gui, network), "Move Overhead" in uci
+
+		private:
+			time_point start_time = 0;
+			time_point optimum_time = 0;
+			time_point maximum_time = 0;
+		};
+	}
+}
+
+#endif
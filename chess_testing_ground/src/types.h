@@ -13,6 +13,7 @@ constexpr int MAX_PLY = 246;
 
 constexpr int VALUE_ZERO = 0;
 constexpr int VALUE_DRAW = 0;
+constexpr int VALUE_KNOWN_WIN = 10000;
 constexpr int VALUE_NONE = 32002;
 constexpr int VALUE_INFINITE = 32001;
           
@@ -24,6 +25,9 @@ constexpr int VALUE_TB = VALUE_MATE_IN_MAX_PLY - 1;
 constexpr int VALUE_TB_WIN_IN_MAX_PLY = VALUE_TB - MAX_PLY;
 constexpr int VALUE_TB_LOSS_IN_MAX_PLY = -VALUE_TB_WIN_IN_MAX_PLY;
 
+constexpr int mate_in(int ply) { return VALUE_MATE - ply; }
+constexpr int mated_in(int ply) { return -VALUE_MATE + ply; }
+
 constexpr int pawn_value = 208;
 constexpr int knight_value = 781;
 constexpr int bishop_value = 825;
@@ -219,7 +223,7 @@ inline square& operator--(square& d) { return d = square(int(d) - 1); }
 constexpr square operator+(square s, direction d) { return square(int(s) + int(d)); }
 constexpr square operator-(square s, direction d) { return square(int(s) - int(d)); }
 inline square& operator+=(square& s, direction d) { return s = s + d; }
-inline square& operator-=(square& s, direction d) { return s = s + d; }
+inline square& operator-=(square& s, direction d) { return s = s - d; }
 
 inline file& operator++(file& d) { return d = file(int(d) + 1); } 
 inline file& operator--(file& d) { return d = file(int(d) - 1); }
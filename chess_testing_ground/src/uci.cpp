@@ -3,6 +3,9 @@
 #include <sstream>
 #include <string>
 
+#include "benchmark.h"
+#include "book.h"
+#include "evaluate.h"
 #include "types.h"
 #include "position.h"
 #include "move_gen.h"
@@ -33,13 +36,55 @@ namespace engine {
             token.clear();
             is >> std::skipws >> token;
 
-            if (token == "position") {
+            if (token == "stop" || token == "quit")
+                e.stop();
+            else if (token == "ponderhit")
+                e.ponderhit();
+            else if (token == "position") {
                 pos(is);
                 std::cout << e.visualize();
             }
+            else if (token == "go")
+                go(is);
+            else if (token == "uci")
+                sync_cout << "id name chess_testing_ground\nid author chess_testing_ground\n"
+                    << "option name Hash type spin default 16 min 1 max 33554432\n"
+                    << "option name EvalFile type string default nn.nnue\n"
+                    << "option name Use NNUE type check default true\n"
+                    << "option name Move Overhead type spin default 10 min 0 max 5000\n"
+                    << "option name Ponder type check default false\n"
+                    << "option name MultiPV type spin default 1 min 1 max 256\n"
+                    << "option name SearchMode type combo default alphabeta var alphabeta var mcts\n"
+                    << "option name MCTSThreads type spin default 1 min 1 max 256\n"
+                    << "option name BookFile type string default <empty>\n"
+                    << "option name BookDepth type spin default 16 min 0 max 1024\n"
+                    << "option name BookRandomness type spin default 100 min 0 max 100\n"
+                    << "option name SyzygyPath type string default <empty>\n"
+                    << "option name SyzygyProbeDepth type spin default 1 min 1 max 100\n"
+                    << "option name Syzygy50MoveRule type check default true\n"
+                    << "option name SyzygyProbeLimit type spin default 7 min 0 max 7\n"
+                    << "option name NullMove type check default true\n"
+                    << "option name LMR type check default true\n"
+                    << "option name Futility type check default true\n"
+                    << "option name ReverseFutility type check default true\n"
+                    << "option name LateMovePruning type check default true\n"
+                    << "option name SEEPruning type check default true\n"
+                    << "option name Aspiration type check default true\n"
+                    << "uciok" << sync_endl;
+            else if (token == "setoption")
+                setoption(is);
+            else if (token == "isready")
+                sync_cout << "readyok" << sync_endl;
+            else if (token == "ucinewgame")
+                e.search_clear();
+            else if (token == "bench")
+                bench(is);
 
             
         } while (token != "quit" && cli.argc == 1);
+
+        //commands given on the command line run to the end before we exit
+        e.wait_for_search_finished();
     }
 
     void uci_engine::pos(std::istringstream& is) {
@@ -67,14 +112,143 @@ namespace engine {
         e.set_position(fen, moves);
     }
 
+    void uci_engine::go(std::istringstream& is) {
+        search::limits_type limits;
+        std::string token;
+
+        limits.start_time = search::now(); //as early as possible
+
+        while (is >> token) {
+            if (token == "searchmoves")
+                while (is >> token)
+                    limits.search_moves.push_back(to_lower(token));
+            else if (token == "depth")
+                is >> limits.depth;
+            else if (token == "nodes")
+                is >> limits.nodes;
+            else if (token == "mate")
+                is >> limits.mate;
+            else if (token == "wtime")
+                is >> limits.time[WHITE];
+            else if (token == "btime")
+                is >> limits.time[BLACK];
+            else if (token == "winc")
+                is >> limits.inc[WHITE];
+            else if (token == "binc")
+                is >> limits.inc[BLACK];
+            else if (token == "movestogo")
+                is >> limits.movestogo;
+            else if (token == "movetime")
+                is >> limits.movetime;
+            else if (token == "perft")
+                is >> limits.perft;
+            else if (token == "infinite")
+                limits.infinite = true;
+            else if (token == "ponder")
+                limits.ponder_mode = true;
+        }
+
+        e.go(limits);
+    }
+
+    void uci_engine::setoption(std::istringstream& is) {
+        std::string token, name, value;
+
+        //options change tables the search is reading, so let it finish first
+        e.wait_for_search_finished();
+
+        is >> token; //"name"
+
+        while (is >> token && token != "value")
+            name += (name.empty() ? "" : " ") + token;
+
+        while (is >> token)
+            value += (value.empty() ? "" : " ") + token;
+
+        if (name == "Hash")
+            e.set_tt_size(std::stoi(value));
+        else if (name == "Use NNUE") {
+            eval::use_nnue = value == "true";
+            e.search_clear(); //cached evals belong to the other eval
+        }
+        else if (name == "MultiPV")
+            e.set_multi_pv(std::stoi(value));
+        else if (name == "Ponder")
+            ; //only tells us the gui may send go ponder, nothing to set up
+        else if (name == "SearchMode")
+            mcts::options.enabled = value == "mcts";
+        else if (name == "MCTSThreads")
+            mcts::options.threads = std::stoi(value);
+        else if (name == "BookFile") {
+            if (!book::open(value))
+                sync_cout << "info string failed to open book " << value << sync_endl;
+        }
+        else if (name == "BookDepth")
+            book::options.depth = std::stoi(value);
+        else if (name == "BookRandomness")
+            book::options.randomness = std::stoi(value);
+        else if (name == "SyzygyPath")
+            tablebases::init(value); //folders split by ';'
+        else if (name == "SyzygyProbeDepth")
+            tablebases::options.probe_depth = std::stoi(value);
+        else if (name == "Syzygy50MoveRule")
+            tablebases::options.rule50 = value == "true";
+        else if (name == "SyzygyProbeLimit")
+            tablebases::options.probe_limit = std::stoi(value);
+        else if (name == "Move Overhead")
+            search::time_manager::move_overhead = std::stoi(value);
+        else if (name == "NullMove")
+            search::pruning.null_move = value == "true";
+        else if (name == "LMR")
+            search::pruning.lmr = value == "true";
+        else if (name == "Futility")
+            search::pruning.futility = value == "true";
+        else if (name == "ReverseFutility")
+            search::pruning.reverse_futility = value == "true";
+        else if (name == "LateMovePruning")
+            search::pruning.late_move = value == "true";
+        else if (name == "SEEPruning")
+            search::pruning.see_quiet = value == "true";
+        else if (name == "Aspiration")
+            search::pruning.aspiration = value == "true";
+        else if (name == "EvalFile") {
+            if (!e.load_network(value))
+                sync_cout << "info string failed to load nnue " << value << ", keeping the current eval" << sync_endl;
+            else
+                e.search_clear();
+        }
+        else
+            sync_cout << "info string no such option " << name << sync_endl;
+    }
+
+    void uci_engine::bench(std::istringstream& is) {
+        std::string token = "search";
+        int depth = 0;
+
+        is >> token >> depth;
+
+        if (token == "attacks")
+            benchmark::attack_table_bench(depth ? depth : 3);
+        else if (token == "psqt")
+            benchmark::psqt_bench(depth ? depth : 3);
+        else if (token == "search")
+            benchmark::search_bench(e, depth ? depth : 12);
+        else if (token == "mcts")
+            benchmark::mcts_bench(e, depth ? depth : 20000); //playouts per position, not a depth
+    }
+
     move uci_engine::to_move(const position& _pos, std::string str) {
         str = to_lower(str);
+        move found = move::none();
 
-        for (const auto& m : move_list<LEGAL>(_pos))
-            if (str == n_move(m))
-                return m;
+        generate<LEGAL>(_pos, [&](move m) {
+            if (str != n_move(m))
+                return false;
+            found = m;
+            return true;
+        });
 
-        return move::none();
+        return found;
     }
 
     std::string uci_engine::to_lower(std::string str) {
@@ -23,6 +23,9 @@ namespace engine {
 		static move to_move(const position& _pos, std::string str);
 
 		void pos(std::istringstream& is);
+		void go(std::istringstream& is);
+		void bench(std::istringstream& is);
+		void setoption(std::istringstream& is);
 		void loop();
 	private:
 		command_line cli;
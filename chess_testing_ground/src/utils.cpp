@@ -1,6 +1,9 @@
 #include "utils.h"
 #include "direct.h"
 
+#include <iostream>
+#include <mutex>
+
 
 std::string command_line::get_binary_directory(std::string argv0) { //i aint write this
     std::string pathSeparator;
@@ -42,3 +45,15 @@ std::string command_line::get_working_directory() {
 void prefetch(const void* addr) {
     _mm_prefetch((char const*)addr, _MM_HINT_T0); //yep
 }
+
+std::ostream& operator<<(std::ostream& os, sync_cout_t sc) {
+    static std::mutex m;
+
+    if (sc == IO_LOCK)
+        m.lock();
+
+    if (sc == IO_UNLOCK)
+        m.unlock();
+
+    return os;
+}
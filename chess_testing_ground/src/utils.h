@@ -1,9 +1,12 @@
 #ifndef UTILS_H_INC
 #define UTILS_H_INC
 
+#include <algorithm>
 #include <cstdint>
 #include <assert.h>
+#include <iosfwd>
 #include <string>
+#include <vector>
 #include <xmmintrin.h>
 
 class PRNG {
@@ -57,4 +60,23 @@ public:
     char** argv;
 };
 void prefetch(const void* addr);
+
+//the search thread and the uci thread both write to stdout, whole lines go out under a lock so they never interleave
+//sync_cout << "bestmove " << m << sync_endl;
+enum sync_cout_t { IO_LOCK, IO_UNLOCK };
+std::ostream& operator<<(std::ostream& os, sync_cout_t sc);
+
+#define sync_cout std::cout << IO_LOCK
+#define sync_endl std::endl << IO_UNLOCK
+
+//fixed size table indexed by the low bits of a key, always replaces, entries keep the full key to check for a hit themselves
+//size has to be a power of two
+template<typename T, int size>
+struct hash_table {
+    T* operator[](uint64_t key) { return &table[uint32_t(key) & (size - 1)]; }
+    void clear() { std::fill(table.begin(), table.end(), T{}); }
+
+private:
+    std::vector<T> table = std::vector<T>(size);
+};
 #endif 
\ No newline at end of file